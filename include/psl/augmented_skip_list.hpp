@@ -1,5 +1,6 @@
 #pragma once
 
+#include "perf_counters.hpp"
 #include "utils.h"
 
 #include "skip_list_base.hpp"
@@ -19,10 +20,18 @@ class AugmentedElement : private ElementBase<AugmentedElement> {
 public:
   using ElementBase<AugmentedElement>::Initialize;
   using ElementBase<AugmentedElement>::Finish;
+  using ElementBase<AugmentedElement>::Height;
+  using ElementBase<AugmentedElement>::NeighborAllocator;
+  using ValueAllocator = concurrent_array_allocator::Allocator<int>;
 
   // See comments on `ElementBase<>`.
   AugmentedElement();
   explicit AugmentedElement(size_t random_int);
+  // Like `AugmentedElement(random_int)`, but allocates the neighbor array and
+  // the value array from the given allocators, which must outlive the element,
+  // rather than from the ones that `Initialize()` sets up.
+  AugmentedElement(size_t random_int, NeighborAllocator *neighbor_allocator,
+                   ValueAllocator *value_allocator);
   ~AugmentedElement();
 
   // For each `{left, right}` in the `len`-length array `joins`, concatenate the
@@ -61,6 +70,8 @@ public:
   using ElementBase<AugmentedElement>::FindRepresentative;
   using ElementBase<AugmentedElement>::GetPreviousElement;
   using ElementBase<AugmentedElement>::GetNextElement;
+  using ElementBase<AugmentedElement>::GetOperationCounts;
+  using ElementBase<AugmentedElement>::ResetOperationCounts;
 
 private:
   static void DerivedInitialize();
@@ -83,8 +94,9 @@ namespace {
 constexpr int NA{-1};
 concurrent_array_allocator::Allocator<int> *val_allocator;
 
-int *AllocateValueArray(int len) {
-  int *values{val_allocator->Allocate(len)};
+int *AllocateValueArray(
+    int len, concurrent_array_allocator::Allocator<int> *allocator) {
+  int *values{allocator->Allocate(len)};
   for (int i = 0; i < len; i++) {
     values[i] = 1;
   }
@@ -102,21 +114,30 @@ inline void AugmentedElement::DerivedInitialize() {
 inline void AugmentedElement::DerivedFinish() {
   if (val_allocator != nullptr) {
     delete val_allocator;
+    val_allocator = nullptr;
   }
 }
 
 inline AugmentedElement::AugmentedElement()
     : ElementBase<AugmentedElement>{}, update_level_{NA} {
-  values_ = AllocateValueArray(height_);
+  values_ = AllocateValueArray(height_, val_allocator);
 }
 
 inline AugmentedElement::AugmentedElement(size_t random_int)
-    : ElementBase<AugmentedElement>{random_int}, update_level_{NA} {
-  values_ = AllocateValueArray(height_);
+    : AugmentedElement{random_int, neighbor_allocator_, val_allocator} {}
+
+inline AugmentedElement::AugmentedElement(size_t random_int,
+                                          NeighborAllocator *neighbor_allocator,
+                                          ValueAllocator *value_allocator)
+    : ElementBase<AugmentedElement>{random_int, neighbor_allocator},
+      update_level_{NA} {
+  values_ = AllocateValueArray(height_, value_allocator);
 }
 
 inline AugmentedElement::~AugmentedElement() {
-  val_allocator->Free(values_, height_);
+  // The value array may have come from `val_allocator` or from an allocator
+  // passed to the constructor.
+  ValueAllocator::FreeToOwner(values_);
 }
 
 inline void AugmentedElement::UpdateTopDownSequential(int level) {
@@ -192,6 +213,8 @@ inline void AugmentedElement::UpdateTopDown(int level) {
 // structurally changed.
 inline void AugmentedElement::BatchUpdate(AugmentedElement **elements,
                                           int *new_values, int len) {
+  perf_counters::PhaseCounter phases{"AugmentedElement::BatchUpdate"};
+  phases.Start("claim ancestors");
   if (new_values != nullptr) {
     parlay::parallel_for(
         0, len, [&](size_t i) { elements[i]->values_[0] = new_values[i]; });
@@ -230,11 +253,13 @@ inline void AugmentedElement::BatchUpdate(AugmentedElement **elements,
       }
     }
   });
+  phases.Start("update top-down");
   parlay::parallel_for(0, len, [&](size_t i) {
     if (top_nodes[i] != nullptr) {
       top_nodes[i]->UpdateTopDown(top_nodes[i]->height_ - 1);
     }
   });
+  phases.Stop();
 
   delete_array(top_nodes, len);
 }
@@ -2,116 +2,335 @@
 // Elements of the array are not initialized. If T is an object, the allocator
 // does not call constructors or destructors for T.
 //
-// Do not statically initialize this. This object depends on list_allocator
-// being statically initialized before it can be initialized.
+// Do not statically initialize this. It sizes its per-worker free lists by
+// `parlay::num_workers()`, which may not be ready during static
+// initialization.
 //
 // Implementation: to handle an allocation request of length k, round k up to
 // the nearest power of 2 and give an array of that size. Thus if the max array
 // size is n, there are log(n) sizes to allocate. We handle each of these sizes
 // with a concurrent fixed-size allocator.
+//
+// When built with `PSL_EXACT_SIZE_CLASSES`, every length from 1 to n gets its
+// own fixed-size allocator instead, so no request is rounded up. Skip list
+// elements have Geometric(1/2) heights and allocate arrays of length equal to
+// their height, which averages 2, whereas rounding up to powers of 2 averages
+// about 2.28, so this saves about 12% of those arrays. The price is n rather
+// than log(n) fixed-size allocators, each holding on to its own free blocks.
+//
+// Each allocator owns the memory it hands out, so independent allocators do
+// not interfere with each other, and destroying an allocator releases all of
+// its memory at once, whether or not its arrays were freed.
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
 
-#include <parlay/alloc.h>
+#include <parlay/parallel.h>
+#include <parlay/utilities.h>
+
+#include "numa_placement.hpp"
 
 namespace concurrent_array_allocator {
 
 constexpr int kMaxArrayLength{32};
 
+#ifdef PSL_EXACT_SIZE_CLASSES
+constexpr bool kExactSizeClasses{true};
+#else
+constexpr bool kExactSizeClasses{false};
+#endif
+
+// Returns the smallest power of 2 that is at least `length`.
+constexpr int PowerOfTwoLength(int length) {
+  int rounded{1};
+  while (rounded < length) {
+    rounded *= 2;
+  }
+  return rounded;
+}
+
+// Returns the length of the array that an allocation request of length
+// `length` takes up.
+constexpr int AllocatedLength(int length) {
+  if (length <= 1) {
+    return 1;
+  }
+  return kExactSizeClasses ? length : PowerOfTwoLength(length);
+}
+
+// Concurrent allocator of fixed-size slots.
+//
+// Slots are carved out of `kBlockBytes`-byte blocks aligned to their size, and
+// each block starts with a pointer to the pool that owns it, so the owner of a
+// slot can be found from its address alone. Freed slots go onto a stack for the
+// calling worker, each guarded by its own spinlock, so workers rarely contend.
+// The stacks hold slot addresses rather than threading a list through the
+// slots, so that allocating does not wait on a load from the slot it takes.
+// A worker that frees more than it allocates would grow its stack without
+// bound, so a stack that exceeds `kMaxWorkerRefills` refills' worth of slots
+// moves a refill's worth onto a shared list, and refills take from that list
+// before carving new slots. Blocks are only returned to the system when the
+// pool is destroyed.
+//
+// A pool may place its blocks on NUMA nodes (see "numa_placement.hpp"). Such a
+// pool takes blocks from the system `kBlocksPerPlacedChunk` at a time, so that
+// the kernel does not have to track a placement for every block.
+class Pool {
+public:
+  static constexpr size_t kBlockBytes{size_t{1} << 14};
+  static constexpr size_t kBlocksPerPlacedChunk{64};
+
+  // Slots will hold `slot_bytes` bytes aligned to `alignment`, which must be a
+  // power of 2. Blocks are placed as `placement` says. The pool keeps a stack
+  // of free slots for each of `num_workers` workers.
+  Pool(size_t slot_bytes, size_t alignment,
+       numa_placement::Placement placement = {},
+       size_t num_workers = parlay::num_workers());
+  // Releases all blocks of the pool, including the slots still in use.
+  ~Pool();
+  Pool(const Pool &) = delete;
+  Pool(Pool &&) = delete;
+  Pool &operator=(const Pool &) = delete;
+  Pool &operator=(Pool &&) = delete;
+
+  void *Allocate();
+  // `slot` must have come from this pool.
+  void Free(void *slot);
+  // Same as above, but use the free slots of worker `worker` rather than those
+  // of the calling worker.
+  void *Allocate(size_t worker);
+  void Free(void *slot, size_t worker);
+
+  // Returns the number of bytes the pool has taken from the system.
+  size_t FootprintBytes();
+
+  // Returns the pool that `slot` came from.
+  static Pool *Owner(const void *slot);
+
+private:
+  struct BlockHeader {
+    Pool *owner;
+  };
+  struct alignas(64) WorkerSlots {
+    std::atomic<bool> locked{false};
+    std::vector<void *> free_slots;
+  };
+
+  // Locks and returns the free slots of worker `worker`.
+  WorkerSlots &LockWorkerSlots(size_t worker);
+  static void UnlockWorkerSlots(WorkerSlots *slots);
+  // Moves free slots, about `kRefillBytes` worth, onto `slots`, taking them
+  // from `shared_free_slots_` if it has any and carving unused ones otherwise.
+  void Refill(WorkerSlots *slots);
+
+  static constexpr size_t kRefillBytes{size_t{1} << 12};
+  static constexpr size_t kMaxWorkerRefills{2};
+
+  size_t slot_bytes_;
+  size_t first_slot_offset_;
+  size_t slots_per_refill_;
+  numa_placement::Placement placement_;
+  std::vector<WorkerSlots> worker_slots_;
+  // Guards the fields below.
+  std::mutex mutex_;
+  // Free slots that workers moved off of their stacks, `slots_per_refill_` per
+  // batch.
+  std::vector<std::vector<void *>> shared_free_slots_;
+  size_t footprint_bytes_{0};
+  // Memory taken from the system, each a chunk of one or more blocks.
+  std::vector<void *> chunks_;
+  // Unused slots of the newest block run from `next_slot_` to `block_end_`, and
+  // unused blocks of the newest chunk run from `block_end_` to `chunk_end_`.
+  char *next_slot_{nullptr};
+  char *block_end_{nullptr};
+  char *chunk_end_{nullptr};
+};
+
 template <typename T> class Allocator {
 public:
-  Allocator();
-  // Note that this destructor will call `finish()` on several
-  // `list_allocator<T>`s, so be sure that allocators of the same type aren't
-  // used elsewhere.
-  // TODO(tomtseng): We shouldn't have to think about other objects when calling
-  // a destructor.
-  ~Allocator();
+  // Places the arrays as `placement` says.
+  explicit Allocator(numa_placement::Placement placement = {});
+  // Releases all arrays of the allocator, including the ones still in use.
+  ~Allocator() = default;
   Allocator(const Allocator &) = delete;
   Allocator(Allocator &&) = delete;
   Allocator &operator=(const Allocator &) = delete;
   Allocator &operator=(Allocator &&) = delete;
 
   T *Allocate(int length);
+  // `arr` must have come from this allocator with length `length`.
   void Free(T *arr, int length);
+  // Frees `arr`, which may have come from any `Allocator<T>`, to the allocator
+  // it came from.
+  static void FreeToOwner(T *arr);
 
 private:
-  parlay::type_allocator<T[1]> allocator0;
-  parlay::type_allocator<T[2]> allocator1;
-  parlay::type_allocator<T[4]> allocator2;
-  parlay::type_allocator<T[8]> allocator3;
-  parlay::type_allocator<T[16]> allocator4;
-  parlay::type_allocator<T[32]> allocator5;
+  static constexpr int kNumSizeClasses{
+      kExactSizeClasses ? kMaxArrayLength : 6};
+  static_assert(kExactSizeClasses || PowerOfTwoLength(kMaxArrayLength) ==
+                                         1 << (kNumSizeClasses - 1),
+                "kMaxArrayLength must be a power of 2");
+
+  // Returns the array length of size class `size_class`.
+  static constexpr int ClassLength(int size_class) {
+    return kExactSizeClasses ? size_class + 1 : 1 << size_class;
+  }
+  // Returns the size class that serves requests of length `length`.
+  static int SizeClass(int length) {
+    if (length <= 1) {
+      return 0;
+    }
+    return kExactSizeClasses ? length - 1 : parlay::log2_up(length);
+  }
+
+  // `pools_[i]` hands out arrays of length `ClassLength(i)`.
+  std::unique_ptr<Pool> pools_[kNumSizeClasses];
 };
 
 ///////////////////////////////////////////////////////////////////////////////
 //                           Implementation below.                           //
 ///////////////////////////////////////////////////////////////////////////////
 
-template <typename T> Allocator<T>::Allocator() {
-  // allocator0.init();
-  // allocator1.init();
-  // allocator2.init();
-  // allocator3.init();
-  // allocator4.init();
-  // allocator5.init();
+inline Pool::Pool(size_t slot_bytes, size_t alignment,
+                  numa_placement::Placement placement, size_t num_workers)
+    : placement_{placement}, worker_slots_(std::max<size_t>(num_workers, 1)) {
+  assert(alignment > 0 && (alignment & (alignment - 1)) == 0);
+  slot_bytes = std::max<size_t>(slot_bytes, 1);
+  slot_bytes_ = (slot_bytes + alignment - 1) / alignment * alignment;
+  first_slot_offset_ =
+      (sizeof(BlockHeader) + alignment - 1) / alignment * alignment;
+  assert(first_slot_offset_ + slot_bytes_ <= kBlockBytes);
+  slots_per_refill_ = std::max<size_t>(kRefillBytes / slot_bytes_, 1);
 }
 
-template <typename T> Allocator<T>::~Allocator() {
-  // allocator0.finish();
-  // allocator1.finish();
-  // allocator2.finish();
-  // allocator3.finish();
-  // allocator4.finish();
-  // allocator5.finish();
+inline Pool::~Pool() {
+  for (void *chunk : chunks_) {
+    std::free(chunk);
+  }
+}
+
+inline Pool *Pool::Owner(const void *slot) {
+  const uintptr_t block{reinterpret_cast<uintptr_t>(slot) &
+                        ~static_cast<uintptr_t>(kBlockBytes - 1)};
+  return reinterpret_cast<const BlockHeader *>(block)->owner;
+}
+
+inline Pool::WorkerSlots &Pool::LockWorkerSlots(size_t worker) {
+  WorkerSlots &slots{worker_slots_[std::min(worker, worker_slots_.size() - 1)]};
+  while (slots.locked.exchange(true, std::memory_order_acquire)) {
+    while (slots.locked.load(std::memory_order_relaxed)) {
+    }
+  }
+  return slots;
+}
+
+inline void Pool::UnlockWorkerSlots(WorkerSlots *slots) {
+  slots->locked.store(false, std::memory_order_release);
+}
+
+inline void Pool::Refill(WorkerSlots *slots) {
+  std::lock_guard<std::mutex> lock{mutex_};
+  if (!shared_free_slots_.empty()) {
+    const std::vector<void *> &batch{shared_free_slots_.back()};
+    slots->free_slots.insert(slots->free_slots.end(), batch.begin(),
+                             batch.end());
+    shared_free_slots_.pop_back();
+    return;
+  }
+  for (size_t i = 0; i < slots_per_refill_; i++) {
+    if (static_cast<size_t>(block_end_ - next_slot_) < slot_bytes_) {
+      if (block_end_ == chunk_end_) {
+        const size_t chunk_bytes{
+            placement_.policy == numa_placement::Policy::kFirstTouch
+                ? kBlockBytes
+                : kBlocksPerPlacedChunk * kBlockBytes};
+        void *chunk{std::aligned_alloc(kBlockBytes, chunk_bytes)};
+        if (chunk == nullptr) {
+          throw std::bad_alloc{};
+        }
+        numa_placement::Place(chunk, chunk_bytes, placement_);
+        chunks_.push_back(chunk);
+        footprint_bytes_ += chunk_bytes;
+        block_end_ = static_cast<char *>(chunk);
+        chunk_end_ = static_cast<char *>(chunk) + chunk_bytes;
+      }
+      new (block_end_) BlockHeader{this};
+      next_slot_ = block_end_ + first_slot_offset_;
+      block_end_ += kBlockBytes;
+    }
+    slots->free_slots.push_back(next_slot_);
+    next_slot_ += slot_bytes_;
+  }
+}
+
+inline void *Pool::Allocate() { return Allocate(parlay::worker_id()); }
+
+inline void Pool::Free(void *slot) { Free(slot, parlay::worker_id()); }
+
+inline void *Pool::Allocate(size_t worker) {
+  WorkerSlots &slots{LockWorkerSlots(worker)};
+  if (slots.free_slots.empty()) {
+    Refill(&slots);
+  }
+  void *slot{slots.free_slots.back()};
+  slots.free_slots.pop_back();
+  UnlockWorkerSlots(&slots);
+  return slot;
+}
+
+inline void Pool::Free(void *slot, size_t worker) {
+  assert(Owner(slot) == this);
+  WorkerSlots &slots{LockWorkerSlots(worker)};
+  slots.free_slots.push_back(slot);
+  if (slots.free_slots.size() <= kMaxWorkerRefills * slots_per_refill_) {
+    UnlockWorkerSlots(&slots);
+    return;
+  }
+  const auto surplus_begin{slots.free_slots.end() - slots_per_refill_};
+  std::vector<void *> batch(surplus_begin, slots.free_slots.end());
+  slots.free_slots.erase(surplus_begin, slots.free_slots.end());
+  UnlockWorkerSlots(&slots);
+  std::lock_guard<std::mutex> lock{mutex_};
+  shared_free_slots_.push_back(std::move(batch));
+}
+
+inline size_t Pool::FootprintBytes() {
+  std::lock_guard<std::mutex> lock{mutex_};
+  return footprint_bytes_;
+}
+
+template <typename T>
+Allocator<T>::Allocator(numa_placement::Placement placement) {
+  for (int i = 0; i < kNumSizeClasses; i++) {
+    pools_[i].reset(
+        new Pool{ClassLength(i) * sizeof(T), alignof(T), placement});
+  }
 }
 
 template <typename T> T *Allocator<T>::Allocate(int length) {
-  switch (parlay::log2_up(length)) {
-  case 0:
-    return *allocator0.alloc();
-  case 1:
-    return *allocator1.alloc();
-  case 2:
-    return *allocator2.alloc();
-  case 3:
-    return *allocator3.alloc();
-  case 4:
-    return *allocator4.alloc();
-  case 5:
-    return *allocator5.alloc();
-  default:
+  if (length > kMaxArrayLength) {
     return nullptr;
   }
+  return static_cast<T *>(pools_[SizeClass(length)]->Allocate());
 }
 
 template <typename T> void Allocator<T>::Free(T *arr, int length) {
-  // To justify this `reinterpret_cast`, we use that a pointer to a static array
-  // and a static array itself both point to the same address: the base of the
-  // array.
-  switch (parlay::log2_up(length)) {
-  case 0:
-    allocator0.free(reinterpret_cast<T(*)[1]>(arr));
-    break;
-  case 1:
-    allocator1.free(reinterpret_cast<T(*)[2]>(arr));
-    break;
-  case 2:
-    allocator2.free(reinterpret_cast<T(*)[4]>(arr));
-    break;
-  case 3:
-    allocator3.free(reinterpret_cast<T(*)[8]>(arr));
-    break;
-  case 4:
-    allocator4.free(reinterpret_cast<T(*)[16]>(arr));
-    break;
-  case 5:
-    allocator5.free(reinterpret_cast<T(*)[32]>(arr));
-    break;
-  default:
-    assert(false);
-  }
+  assert(length <= kMaxArrayLength);
+  pools_[SizeClass(length)]->Free(arr);
+}
+
+template <typename T> void Allocator<T>::FreeToOwner(T *arr) {
+  Pool::Owner(arr)->Free(arr);
 }
 
 } // namespace concurrent_array_allocator
@@ -0,0 +1,158 @@
+// Placement of memory on NUMA nodes.
+//
+// Memory is placed through the `mbind` system call, so no library is needed.
+// Placing a range also moves the pages of the range that are already in
+// memory. Only whole pages inside a range are placed, so that pages shared
+// with neighboring allocations keep their placement. On machines with one node,
+// or where `mbind` is unavailable, placement has no effect.
+//
+// Example:
+//   const size_t bytes{n * sizeof(int)};
+//   int *a{static_cast<int *>(std::aligned_alloc(4096, bytes))};
+//   numa_placement::Place(a, bytes, {numa_placement::Policy::kInterleaved});
+//   // The pages of `a` are spread round-robin over the nodes once touched.
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace numa_placement {
+
+enum class Policy {
+  // Leave each page on the node of the thread that first touches it.
+  kFirstTouch,
+  // Spread pages round-robin over all nodes.
+  kInterleaved,
+  // Put pages on one chosen node.
+  kPartitioned,
+};
+
+// Returns the name of `policy` as taken by `ParsePolicy`.
+inline const char *PolicyName(Policy policy) {
+  switch (policy) {
+  case Policy::kInterleaved:
+    return "interleaved";
+  case Policy::kPartitioned:
+    return "partitioned";
+  default:
+    return "first-touch";
+  }
+}
+
+// Sets `*policy` to the policy named `name` ("first-touch", "interleaved", or
+// "partitioned") and returns true, or returns false if there is no such policy.
+inline bool ParsePolicy(const std::string &name, Policy *policy) {
+  for (Policy p :
+       {Policy::kFirstTouch, Policy::kInterleaved, Policy::kPartitioned}) {
+    if (name == PolicyName(p)) {
+      *policy = p;
+      return true;
+    }
+  }
+  return false;
+}
+
+// Where to put some memory. `node` is only used by `Policy::kPartitioned`, and
+// is an index into the nodes in the order of `Nodes()`, not a node ID.
+struct Placement {
+  Policy policy{Policy::kFirstTouch};
+  int node{0};
+};
+
+// Returns the IDs of the online nodes in increasing order, or {0} if they
+// cannot be read.
+inline const std::vector<int> &Nodes() {
+  static const std::vector<int> nodes{[] {
+    // The file holds a list of ranges such as "0-1,4".
+    std::vector<int> ids;
+    std::ifstream file{"/sys/devices/system/node/online"};
+    std::string range;
+    while (std::getline(file, range, ',')) {
+      const size_t dash{range.find('-')};
+      try {
+        const int first{std::stoi(range.substr(0, dash))};
+        const int last{dash == std::string::npos
+                           ? first
+                           : std::stoi(range.substr(dash + 1))};
+        for (int id = first; id <= last; id++) {
+          ids.push_back(id);
+        }
+      } catch (const std::exception &) {
+        return std::vector<int>{0};
+      }
+    }
+    return ids.empty() ? std::vector<int>{0} : ids;
+  }()};
+  return nodes;
+}
+
+inline int NumNodes() { return static_cast<int>(Nodes().size()); }
+
+#ifdef __linux__
+
+namespace _internal {
+
+// Calls `mbind` on the whole pages in [`begin`, `begin` + `bytes`) with node
+// mask `node_ids`.
+inline void Bind(void *begin, size_t bytes, int mode,
+                 const std::vector<int> &node_ids) {
+  const uintptr_t page_size{static_cast<uintptr_t>(sysconf(_SC_PAGESIZE))};
+  const uintptr_t start{(reinterpret_cast<uintptr_t>(begin) + page_size - 1) /
+                        page_size * page_size};
+  const uintptr_t end{(reinterpret_cast<uintptr_t>(begin) + bytes) /
+                      page_size * page_size};
+  if (start >= end) {
+    return;
+  }
+  constexpr int kBitsPerWord{8 * sizeof(unsigned long)};
+  std::vector<unsigned long> mask(Nodes().back() / kBitsPerWord + 1);
+  for (int id : node_ids) {
+    mask[id / kBitsPerWord] |= 1UL << (id % kBitsPerWord);
+  }
+  // The kernel reads one bit fewer than `maxnode`.
+  const unsigned long max_node{mask.size() * kBitsPerWord + 1};
+  // Failure leaves the pages where they are, which is always correct.
+  static_cast<void>(syscall(SYS_mbind, start, end - start, mode, mask.data(),
+                            max_node, MPOL_MF_MOVE));
+}
+
+} // namespace _internal
+
+// Places the memory [`begin`, `begin` + `bytes`) as `placement` says. Placing
+// memory with `Policy::kFirstTouch` does nothing.
+inline void Place(void *begin, size_t bytes, Placement placement) {
+  if (NumNodes() == 1) {
+    return;
+  }
+  switch (placement.policy) {
+  case Policy::kInterleaved:
+    _internal::Bind(begin, bytes, MPOL_INTERLEAVE, Nodes());
+    break;
+  case Policy::kPartitioned:
+    // Unlike `MPOL_BIND`, `MPOL_PREFERRED` falls back to other nodes when the
+    // chosen node is out of memory.
+    _internal::Bind(begin, bytes, MPOL_PREFERRED,
+                    {Nodes()[placement.node % NumNodes()]});
+    break;
+  default:
+    break;
+  }
+}
+
+#else // __linux__
+
+inline void Place(void *, size_t, Placement) {}
+
+#endif // __linux__
+
+} // namespace numa_placement
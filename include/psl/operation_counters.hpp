@@ -0,0 +1,121 @@
+// Optional counters of the internal work done by skip list operations.
+//
+// When compiled with `PSL_OPERATION_COUNTERS` defined (CMake option
+// `-DPSL_OPERATION_COUNTERS=ON`), each `ElementBase<Derived>` counts, per
+// ParlayLib worker, the CAS attempts and failures on neighbor pointers, the
+// levels climbed by each `Join` and `Split`, the elements visited by each
+// `FindLeftParent` and `FindRightParent`, and the pointers followed by each
+// `FindRepresentative`. `ElementBase<Derived>::GetOperationCounts()` sums the
+// workers' counts. Otherwise nothing is counted and the sums are zero.
+//
+// Each worker only writes to its own cache line, so counting adds no
+// contention, but counts made by threads outside of ParlayLib's scheduler
+// may race with worker 0's.
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#ifdef PSL_OPERATION_COUNTERS
+#include <parlay/parallel.h>
+#endif
+
+namespace operation_counters {
+
+#ifdef PSL_OPERATION_COUNTERS
+constexpr bool kEnabled{true};
+#else
+constexpr bool kEnabled{false};
+#endif
+
+struct OperationCounts {
+  uint64_t cas_attempts;
+  uint64_t cas_failures;
+  uint64_t joins;
+  // Sum over all `Join` calls of the number of levels linked.
+  uint64_t join_levels;
+  uint64_t splits;
+  // Sum over all `Split` calls of the number of levels unlinked.
+  uint64_t split_levels;
+  // Calls to `FindLeftParent` and `FindRightParent`.
+  uint64_t parent_searches;
+  uint64_t parent_search_visits;
+  uint64_t representative_searches;
+  uint64_t representative_hops;
+  // Most pointers followed by a single `FindRepresentative` call.
+  uint64_t max_representative_hops;
+
+  OperationCounts &operator+=(const OperationCounts &other) {
+    cas_attempts += other.cas_attempts;
+    cas_failures += other.cas_failures;
+    joins += other.joins;
+    join_levels += other.join_levels;
+    splits += other.splits;
+    split_levels += other.split_levels;
+    parent_searches += other.parent_searches;
+    parent_search_visits += other.parent_search_visits;
+    representative_searches += other.representative_searches;
+    representative_hops += other.representative_hops;
+    max_representative_hops =
+        std::max(max_representative_hops, other.max_representative_hops);
+    return *this;
+  }
+};
+
+// Prints the counts along with the averages per call.
+inline void ReportOperationCounts(std::ostream &out,
+                                  const OperationCounts &counts) {
+  const auto average{[](uint64_t total, uint64_t calls) {
+    return calls > 0 ? static_cast<double>(total) / calls : 0.0;
+  }};
+  out << "  cas attempts " << counts.cas_attempts << " failures "
+      << counts.cas_failures << '\n'
+      << "  join calls " << counts.joins << " levels/call "
+      << average(counts.join_levels, counts.joins) << '\n'
+      << "  split calls " << counts.splits << " levels/call "
+      << average(counts.split_levels, counts.splits) << '\n'
+      << "  parent search calls " << counts.parent_searches << " visits/call "
+      << average(counts.parent_search_visits, counts.parent_searches) << '\n'
+      << "  representative calls " << counts.representative_searches
+      << " hops/call "
+      << average(counts.representative_hops, counts.representative_searches)
+      << " max hops " << counts.max_representative_hops << '\n';
+}
+
+#ifdef PSL_OPERATION_COUNTERS
+
+// One `OperationCounts` per worker, each on its own cache line.
+class PerWorkerCounts {
+public:
+  PerWorkerCounts() : counts_(parlay::num_workers()) {}
+
+  OperationCounts &Local() {
+    return counts_[std::min(parlay::worker_id(), counts_.size() - 1)].counts;
+  }
+
+  OperationCounts Sum() const {
+    OperationCounts sum{};
+    for (const PaddedCounts &worker_counts : counts_) {
+      sum += worker_counts.counts;
+    }
+    return sum;
+  }
+
+  void Reset() {
+    for (PaddedCounts &worker_counts : counts_) {
+      worker_counts.counts = OperationCounts{};
+    }
+  }
+
+private:
+  struct alignas(64) PaddedCounts {
+    OperationCounts counts{};
+  };
+  std::vector<PaddedCounts> counts_;
+};
+
+#endif // PSL_OPERATION_COUNTERS
+
+} // namespace operation_counters
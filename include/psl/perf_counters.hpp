@@ -0,0 +1,313 @@
+// Optional hardware performance counters for the phases of batch operations.
+//
+// When compiled with `PSL_PERF_COUNTERS` defined (CMake option
+// `-DPSL_PERF_COUNTERS=ON`), a `PhaseCounter` reads cycles, last-level cache
+// misses, dTLB misses, branch misses, and NUMA node loads on every ParlayLib
+// worker through `perf_event_open` at each phase boundary and adds the
+// differences to a process-wide table of phases. Otherwise `PhaseCounter` does
+// nothing and the table stays empty.
+//
+// Node loads are loads that missed the caches and went to memory.
+// "node-load-misses" counts those served by the memory of another NUMA node,
+// so its ratio to "node-loads" measures the cross-socket traffic.
+//
+// Only user-space events are counted, so this works under the default
+// `perf_event_paranoid` setting. If the events cannot be opened, `Available()`
+// returns false and all counts are zero.
+//
+// Example:
+//   perf_counters::PhaseCounter phases{"EulerTourTree::BatchLink"};
+//   phases.Start("sort");
+//   ...
+//   phases.Start("split");  // ends "sort"
+//   ...
+//   phases.Stop();
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#ifdef PSL_PERF_COUNTERS
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+#include <parlay/parallel.h>
+#endif
+
+namespace perf_counters {
+
+enum Event {
+  kCycles,
+  kLlcMisses,
+  kDtlbMisses,
+  kBranchMisses,
+  kNodeLoads,
+  kNodeLoadMisses,
+  kNumEvents
+};
+
+constexpr const char *kEventNames[kNumEvents]{
+    "cycles",        "llc-misses", "dtlb-misses",
+    "branch-misses", "node-loads", "node-load-misses"};
+
+// Event counts summed over all workers and over all `calls` executions of a
+// phase. `name` is "<operation>/<phase>".
+struct PhaseCounts {
+  std::string name;
+  uint64_t calls;
+  uint64_t counts[kNumEvents];
+};
+
+// Adds each phase in `counts` to the phase of the same name in `totals`.
+inline void AddPhaseCounts(std::vector<PhaseCounts> *totals,
+                           const std::vector<PhaseCounts> &counts) {
+  for (const PhaseCounts &phase : counts) {
+    PhaseCounts *total{nullptr};
+    for (PhaseCounts &t : *totals) {
+      if (t.name == phase.name) {
+        total = &t;
+        break;
+      }
+    }
+    if (total == nullptr) {
+      totals->push_back(phase);
+      continue;
+    }
+    total->calls += phase.calls;
+    for (int i = 0; i < kNumEvents; i++) {
+      total->counts[i] += phase.counts[i];
+    }
+  }
+}
+
+// Prints one line per phase with the counts divided by `divisor`, e.g., the
+// number of iterations they were summed over.
+inline void ReportPhaseCounts(std::ostream &out,
+                              const std::vector<PhaseCounts> &counts,
+                              double divisor = 1) {
+  for (const PhaseCounts &phase : counts) {
+    out << "  phase " << phase.name << " : calls " << phase.calls / divisor;
+    for (int i = 0; i < kNumEvents; i++) {
+      out << ' ' << kEventNames[i] << ' ' << phase.counts[i] / divisor;
+    }
+    out << '\n';
+  }
+}
+
+#ifdef PSL_PERF_COUNTERS
+
+namespace _internal {
+
+// Per-worker counters and the table of phase counts.
+class Counters {
+public:
+  static Counters &Get() {
+    static Counters counters;
+    return counters;
+  }
+
+  Counters(const Counters &) = delete;
+  Counters &operator=(const Counters &) = delete;
+
+  bool Available() const { return available_; }
+
+  // Sums each event over all workers.
+  void Read(uint64_t *counts) const {
+    for (int i = 0; i < kNumEvents; i++) {
+      counts[i] = 0;
+    }
+    for (size_t j = 0; j < fds_.size(); j++) {
+      const int fd{fds_[j]};
+      // With `read_format` below, a read gives the value, the time enabled and
+      // the time running. Scale the value up if the event was multiplexed.
+      uint64_t values[3];
+      if (fd >= 0 && read(fd, values, sizeof(values)) == sizeof(values) &&
+          values[2] > 0) {
+        counts[j % kNumEvents] += static_cast<uint64_t>(
+            static_cast<double>(values[0]) * values[1] / values[2]);
+      }
+    }
+  }
+
+  void Add(const std::string &name, const uint64_t *counts) {
+    PhaseCounts phase{name, 1, {}};
+    for (int i = 0; i < kNumEvents; i++) {
+      phase.counts[i] = counts[i];
+    }
+    std::lock_guard<std::mutex> lock{mutex_};
+    AddPhaseCounts(&phases_, {phase});
+  }
+
+  std::vector<PhaseCounts> Take() {
+    std::lock_guard<std::mutex> lock{mutex_};
+    std::vector<PhaseCounts> phases;
+    phases.swap(phases_);
+    return phases;
+  }
+
+private:
+  Counters() {
+    constexpr uint64_t kCacheReadMiss{(PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                                      (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+    constexpr uint64_t kCacheReadAccess{
+        (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_ACCESS << 16)};
+    const uint32_t types[kNumEvents]{PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+                                     PERF_TYPE_HW_CACHE, PERF_TYPE_HARDWARE,
+                                     PERF_TYPE_HW_CACHE, PERF_TYPE_HW_CACHE};
+    const uint64_t configs[kNumEvents]{
+        PERF_COUNT_HW_CPU_CYCLES,
+        PERF_COUNT_HW_CACHE_LL | kCacheReadMiss,
+        PERF_COUNT_HW_CACHE_DTLB | kCacheReadMiss,
+        PERF_COUNT_HW_BRANCH_MISSES,
+        PERF_COUNT_HW_CACHE_NODE | kCacheReadAccess,
+        PERF_COUNT_HW_CACHE_NODE | kCacheReadMiss};
+    for (pid_t tid : WorkerThreadIds()) {
+      for (int i = 0; i < kNumEvents; i++) {
+        perf_event_attr attr{};
+        attr.size = sizeof(attr);
+        attr.type = types[i];
+        attr.config = configs[i];
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format =
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        const int fd{static_cast<int>(
+            syscall(SYS_perf_event_open, &attr, tid, -1, -1, 0))};
+        fds_.push_back(fd);
+        available_ |= fd >= 0;
+      }
+    }
+  }
+
+  ~Counters() {
+    for (int fd : fds_) {
+      if (fd >= 0) {
+        close(fd);
+      }
+    }
+  }
+
+  // Returns the thread IDs of the ParlayLib workers. Each iteration of the
+  // loop below waits until every worker has picked one up (or until a timeout
+  // passes), so the iterations are spread over all workers.
+  static std::vector<pid_t> WorkerThreadIds() {
+    const size_t num_workers{parlay::num_workers()};
+    std::vector<pid_t> tids(num_workers, -1);
+    std::atomic<size_t> num_arrived{0};
+    const auto deadline{std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(100)};
+    parlay::parallel_for(
+        0, num_workers,
+        [&](size_t) {
+          tids[parlay::worker_id()] = static_cast<pid_t>(syscall(SYS_gettid));
+          num_arrived++;
+          while (num_arrived < num_workers &&
+                 std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::yield();
+          }
+        },
+        1);
+    std::vector<pid_t> found_tids;
+    for (pid_t tid : tids) {
+      if (tid != -1) {
+        found_tids.push_back(tid);
+      }
+    }
+    return found_tids;
+  }
+
+  std::vector<int> fds_;
+  bool available_{false};
+  std::mutex mutex_;
+  std::vector<PhaseCounts> phases_;
+};
+
+} // namespace _internal
+
+// Opens the counters. This happens on first use anyway, but calling this
+// beforehand keeps the setup cost out of the first measured phase.
+inline void Initialize() { _internal::Counters::Get(); }
+
+inline bool Available() { return _internal::Counters::Get().Available(); }
+
+// Returns the counts of all phases recorded since the last call and clears
+// them.
+inline std::vector<PhaseCounts> TakePhaseCounts() {
+  return _internal::Counters::Get().Take();
+}
+
+// Records consecutive phases of one operation. Phases must not overlap, and a
+// `PhaseCounter` should only be used by the thread that created it.
+class PhaseCounter {
+public:
+  explicit PhaseCounter(const char *operation) : operation_{operation} {}
+  ~PhaseCounter() { Stop(); }
+  PhaseCounter(const PhaseCounter &) = delete;
+  PhaseCounter &operator=(const PhaseCounter &) = delete;
+
+  // Ends the current phase, if any, and starts the phase `phase`.
+  void Start(const char *phase) {
+    _internal::Counters &counters{_internal::Counters::Get()};
+    uint64_t now[kNumEvents];
+    counters.Read(now);
+    Record(now);
+    phase_ = phase;
+    for (int i = 0; i < kNumEvents; i++) {
+      start_[i] = now[i];
+    }
+  }
+
+  // Ends the current phase, if any.
+  void Stop() {
+    if (phase_ != nullptr) {
+      uint64_t now[kNumEvents];
+      _internal::Counters::Get().Read(now);
+      Record(now);
+      phase_ = nullptr;
+    }
+  }
+
+private:
+  void Record(const uint64_t *now) {
+    if (phase_ == nullptr) {
+      return;
+    }
+    uint64_t counts[kNumEvents];
+    for (int i = 0; i < kNumEvents; i++) {
+      // Scaled counts of multiplexed events may decrease slightly.
+      counts[i] = now[i] > start_[i] ? now[i] - start_[i] : 0;
+    }
+    _internal::Counters::Get().Add(std::string{operation_} + '/' + phase_,
+                                   counts);
+  }
+
+  const char *operation_;
+  const char *phase_{nullptr};
+  uint64_t start_[kNumEvents];
+};
+
+#else // PSL_PERF_COUNTERS
+
+inline void Initialize() {}
+inline bool Available() { return false; }
+inline std::vector<PhaseCounts> TakePhaseCounts() { return {}; }
+
+class PhaseCounter {
+public:
+  explicit PhaseCounter(const char *) {}
+  void Start(const char *) {}
+  void Stop() {}
+};
+
+#endif // PSL_PERF_COUNTERS
+
+} // namespace perf_counters
@@ -7,6 +7,8 @@ namespace parallel_skip_list {
 class Element : public ElementBase<Element> {
 public:
   explicit Element(size_t random_int) : ElementBase<Element>{random_int} {}
+  Element(size_t random_int, NeighborAllocator *neighbor_allocator)
+      : ElementBase<Element>{random_int, neighbor_allocator} {}
 
 private:
   friend class ElementBase<Element>;
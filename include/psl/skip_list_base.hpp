@@ -1,8 +1,13 @@
 #pragma once
 
 #include "concurrent_array_allocator.hpp"
+#include "operation_counters.hpp"
 #include "utils.h"
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
 #include <parlay/random.h>
+#include <parlay/sequence.h>
+#include <parlay/slice.h>
 
 namespace parallel_skip_list {
 
@@ -24,8 +29,25 @@ namespace parallel_skip_list {
 // elements. This means that elements must not be created as global or static
 // variables. `Finish()` can be called after we are done with all
 // `ElementBase<Derived>` elements.
+//
+// Elements may instead take their neighbor arrays from an allocator of their
+// own, which need not be shared with any other list. Several independent
+// groups of lists can then come and go without calling `Initialize()` or
+// `Finish()`, and destroying a group's allocator releases all of its neighbor
+// arrays at once.
+//
+// When built with `PSL_OPERATION_COUNTERS`, elements count the work done inside
+// their operations (see "operation_counters.hpp").
 template <typename Derived> class ElementBase {
+protected:
+  struct Neighbors {
+    Derived *prev;
+    Derived *next;
+  };
+
 public:
+  using NeighborAllocator = concurrent_array_allocator::Allocator<Neighbors>;
+
   // Call this before creating any `ElementBase<Derived>` elements.
   static void Initialize();
   // Call this after being done with `ElementBase<Derived>`.
@@ -36,6 +58,10 @@ public:
   ElementBase();
   // Uses random_int as a seed to generate a random height for the element.
   explicit ElementBase(size_t random_int);
+  // Like `ElementBase(random_int)`, but allocates the neighbor array from
+  // `neighbor_allocator`, which must outlive the element, rather than from the
+  // allocator that `Initialize()` sets up.
+  ElementBase(size_t random_int, NeighborAllocator *neighbor_allocator);
 
   virtual ~ElementBase();
   ElementBase(const ElementBase &) = delete;
@@ -46,6 +72,11 @@ public:
   Derived *GetPreviousElement() const;
   Derived *GetNextElement() const;
 
+  // Returns the number of skip list levels that the element is on. The element
+  // holds an array of `Height()` neighbor pairs, which takes up
+  // `concurrent_array_allocator::AllocatedLength(Height())` pairs of memory.
+  int Height() const { return height_; }
+
   // Returns a representative element from the list the element lives in. Two
   // elements have the same representative element if and only if they reside in
   // the same list.
@@ -54,6 +85,14 @@ public:
   // call.
   Derived *FindRepresentative() const;
 
+  // Returns all elements of the list that `element` lives in, in list order. A
+  // cyclic list is listed starting from its representative. The elements on
+  // each level are listed from those on the level above by walking the
+  // segments between them in parallel, so this takes O(n) expected work and
+  // O(log^2 n) depth with high probability on an n-element list. Must not run
+  // concurrently with `Join` or `Split` calls on the list.
+  static parlay::sequence<Derived *> Flatten(const Derived *element);
+
   // Concatenates the list that `left` lives in to the list that `right` lives
   // in. `left` must be the last element in its list. `right` must be the first
   // element in its list. `left` and `right` are allowed to be in the same list,
@@ -72,12 +111,14 @@ public:
   // May run concurrently with other `Split` calls.
   Derived *Split();
 
-protected:
-  struct Neighbors {
-    Derived *prev;
-    Derived *next;
-  };
+  // Returns the operation counts summed over all workers since the start of
+  // the program or the last `ResetOperationCounts()` call. These are all zero
+  // unless built with `PSL_OPERATION_COUNTERS`. Must not run concurrently with
+  // operations on elements.
+  static operation_counters::OperationCounts GetOperationCounts();
+  static void ResetOperationCounts();
 
+protected:
   bool CASNext(int level, Derived *old_next, Derived *new_next);
   bool CASPrev(int level, Derived *old_prev, Derived *new_prev);
   // When called on element `v`, searches left starting from and including `v`
@@ -87,11 +128,27 @@ protected:
   // for the first element at the next level up.
   Derived *FindRightParent(int level) const;
 
+  // For `Flatten`. Given the elements on level `upper` of a list in list order,
+  // returns the elements on level `lower`, which must be below `upper`, in list
+  // order. If the list is acyclic, `first` must be its first element on
+  // `lower`; otherwise it must be null.
+  static parlay::sequence<Derived *>
+  FlattenLevel(const parlay::sequence<Derived *> &upper_elements, int upper,
+               const Derived *first, int lower);
+
+#ifdef PSL_OPERATION_COUNTERS
+  // Counts of the calling worker.
+  static operation_counters::OperationCounts &LocalOperationCounts();
+  // Constructed on first use rather than at static initialization so that the
+  // number of workers is known.
+  static operation_counters::PerWorkerCounts &OperationCountsTable();
+#endif
+
   // We might think to make this an `ArrayAllocator<T>` instead of a
   // pointer to one, but then we run into a Static Initialization Order Fiasco.
   // When run, our program could choose to initialize `ArrayAllocator<T>`,
   // which uses `list_allocator<T>`, before `list_allocator<T>` is initialized.
-  static concurrent_array_allocator::Allocator<Neighbors> *neighbor_allocator_;
+  static NeighborAllocator *neighbor_allocator_;
   // concurrent_array_allocator::Allocator<Neighbors> *neighbor_allocator_;
   static parlay::random default_randomness_;
 
@@ -107,6 +164,9 @@ protected:
 
 namespace _internal {
 constexpr int kMaxHeight{concurrent_array_allocator::kMaxArrayLength};
+// `Flatten` cuts lists into segments that start at the elements on this level
+// and walks the segments in parallel.
+constexpr int kFlattenSegmentLevel{6};
 inline int GenerateHeight(size_t random_int) {
   int h{1};
   // Geometric(1/2) distribution.
@@ -122,15 +182,14 @@ inline int GenerateHeight(size_t random_int) {
 } // namespace _internal
 
 template <typename Derived>
-concurrent_array_allocator::Allocator<typename ElementBase<Derived>::Neighbors>
+typename ElementBase<Derived>::NeighborAllocator
     *ElementBase<Derived>::neighbor_allocator_{nullptr};
 template <typename Derived>
 parlay::random ElementBase<Derived>::default_randomness_{};
 
 template <typename Derived> void ElementBase<Derived>::Initialize() {
   if (neighbor_allocator_ == nullptr) {
-    neighbor_allocator_ =
-        new concurrent_array_allocator::Allocator<Neighbors>{};
+    neighbor_allocator_ = new NeighborAllocator{};
   }
   Derived::DerivedInitialize();
 }
@@ -138,6 +197,7 @@ template <typename Derived> void ElementBase<Derived>::Initialize() {
 template <typename Derived> void ElementBase<Derived>::Finish() {
   if (neighbor_allocator_ != nullptr) {
     delete neighbor_allocator_;
+    neighbor_allocator_ = nullptr;
   }
   Derived::DerivedFinish();
 }
@@ -153,28 +213,77 @@ template <typename Derived> ElementBase<Derived>::ElementBase() {
 }
 
 template <typename Derived>
-ElementBase<Derived>::ElementBase(size_t random_int) {
+ElementBase<Derived>::ElementBase(size_t random_int)
+    : ElementBase{random_int, neighbor_allocator_} {}
+
+template <typename Derived>
+ElementBase<Derived>::ElementBase(size_t random_int,
+                                 NeighborAllocator *neighbor_allocator) {
   height_ = _internal::GenerateHeight(random_int);
-  neighbors_ = neighbor_allocator_->Allocate(height_);
+  neighbors_ = neighbor_allocator->Allocate(height_);
   for (int i = 0; i < height_; i++) {
     neighbors_[i].prev = neighbors_[i].next = nullptr;
   }
 }
 
 template <typename Derived> ElementBase<Derived>::~ElementBase() {
-  neighbor_allocator_->Free(neighbors_, height_);
+  // The neighbor array may have come from `neighbor_allocator_` or from an
+  // allocator passed to the constructor.
+  NeighborAllocator::FreeToOwner(neighbors_);
+}
+
+#ifdef PSL_OPERATION_COUNTERS
+template <typename Derived>
+operation_counters::PerWorkerCounts &
+ElementBase<Derived>::OperationCountsTable() {
+  static operation_counters::PerWorkerCounts table;
+  return table;
+}
+
+template <typename Derived>
+operation_counters::OperationCounts &
+ElementBase<Derived>::LocalOperationCounts() {
+  return OperationCountsTable().Local();
+}
+#endif
+
+template <typename Derived>
+operation_counters::OperationCounts ElementBase<Derived>::GetOperationCounts() {
+#ifdef PSL_OPERATION_COUNTERS
+  return OperationCountsTable().Sum();
+#else
+  return {};
+#endif
+}
+
+template <typename Derived> void ElementBase<Derived>::ResetOperationCounts() {
+#ifdef PSL_OPERATION_COUNTERS
+  OperationCountsTable().Reset();
+#endif
 }
 
 template <typename Derived>
 bool ElementBase<Derived>::CASNext(int level, Derived *old_next,
                                    Derived *new_next) {
-  return CAS(&neighbors_[level].next, old_next, new_next);
+  const bool success{CAS(&neighbors_[level].next, old_next, new_next)};
+#ifdef PSL_OPERATION_COUNTERS
+  operation_counters::OperationCounts &counts{LocalOperationCounts()};
+  counts.cas_attempts++;
+  counts.cas_failures += !success;
+#endif
+  return success;
 }
 
 template <typename Derived>
 bool ElementBase<Derived>::CASPrev(int level, Derived *old_prev,
                                    Derived *new_prev) {
-  return CAS(&neighbors_[level].prev, old_prev, new_prev);
+  const bool success{CAS(&neighbors_[level].prev, old_prev, new_prev)};
+#ifdef PSL_OPERATION_COUNTERS
+  operation_counters::OperationCounts &counts{LocalOperationCounts()};
+  counts.cas_attempts++;
+  counts.cas_failures += !success;
+#endif
+  return success;
 }
 
 template <typename Derived>
@@ -191,26 +300,44 @@ template <typename Derived>
 Derived *ElementBase<Derived>::FindLeftParent(int level) const {
   const Derived *current_element{static_cast<const Derived *>(this)};
   const Derived *start_element{current_element};
+  const Derived *parent{nullptr};
+  [[maybe_unused]] uint64_t num_visited{0};
   do {
+    num_visited++;
     if (current_element->height_ > level + 1) {
-      return const_cast<Derived *>(current_element);
+      parent = current_element;
+      break;
     }
     current_element = current_element->neighbors_[level].prev;
   } while (current_element != nullptr && current_element != start_element);
-  return nullptr;
+#ifdef PSL_OPERATION_COUNTERS
+  operation_counters::OperationCounts &counts{LocalOperationCounts()};
+  counts.parent_searches++;
+  counts.parent_search_visits += num_visited;
+#endif
+  return const_cast<Derived *>(parent);
 }
 
 template <typename Derived>
 Derived *ElementBase<Derived>::FindRightParent(int level) const {
   const Derived *current_element{static_cast<const Derived *>(this)};
   const Derived *start_element{current_element};
+  const Derived *parent{nullptr};
+  [[maybe_unused]] uint64_t num_visited{0};
   do {
+    num_visited++;
     if (current_element->height_ > level + 1) {
-      return const_cast<Derived *>(current_element);
+      parent = current_element;
+      break;
     }
     current_element = current_element->neighbors_[level].next;
   } while (current_element != nullptr && current_element != start_element);
-  return nullptr;
+#ifdef PSL_OPERATION_COUNTERS
+  operation_counters::OperationCounts &counts{LocalOperationCounts()};
+  counts.parent_searches++;
+  counts.parent_search_visits += num_visited;
+#endif
+  return const_cast<Derived *>(parent);
 }
 
 template <typename Derived>
@@ -219,35 +346,132 @@ Derived *ElementBase<Derived>::FindRepresentative() const {
   // favor of the lowest address.
   // If the list is not cyclic, then return the head element on the highest
   // level.
+  //
+  // Either way we walk forward, moving up a level whenever we reach a taller
+  // element. Each level is expected to take O(1) steps, including the highest
+  // level, whose expected number of elements is O(1) regardless of the length
+  // of the list. On a cyclic list we stop as soon as we are back at the first
+  // element we saw on the highest level, so each element there is visited
+  // once.
 
   const Derived *current_element{static_cast<const Derived *>(this)};
-  const Derived *seen_element{nullptr};
   int current_level{current_element->height_ - 1};
+  // First and lowest-address elements seen on `current_level`.
+  const Derived *level_start{current_element};
+  const Derived *min_element{current_element};
+  [[maybe_unused]] uint64_t num_hops{0};
 
   // walk up while moving forward
-  while (current_element->neighbors_[current_level].next != nullptr &&
-         seen_element != current_element) {
-    if (seen_element == nullptr || current_element < seen_element) {
-      seen_element = current_element;
-    }
+  bool is_cycle{false};
+  while (current_element->neighbors_[current_level].next != nullptr) {
     current_element = current_element->neighbors_[current_level].next;
+    num_hops++;
+    if (current_element == level_start) {
+      is_cycle = true;
+      break;
+    }
     const int top_level{current_element->height_ - 1};
     if (current_level < top_level) {
       current_level = top_level;
-      seen_element = nullptr;
+      level_start = min_element = current_element;
+    } else if (current_element < min_element) {
+      min_element = current_element;
     }
   }
 
-  if (seen_element == current_element) { // list is a cycle
-    return const_cast<Derived *>(seen_element);
+  if (is_cycle) {
+    current_element = min_element;
   } else {
     // walk up while moving backward
     while (current_element->neighbors_[current_level].prev != nullptr) {
       current_element = current_element->neighbors_[current_level].prev;
       current_level = current_element->height_ - 1;
+      num_hops++;
     }
-    return const_cast<Derived *>(current_element);
   }
+
+#ifdef PSL_OPERATION_COUNTERS
+  operation_counters::OperationCounts &counts{LocalOperationCounts()};
+  counts.representative_searches++;
+  counts.representative_hops += num_hops;
+  counts.max_representative_hops =
+      std::max(counts.max_representative_hops, num_hops);
+#endif
+  return const_cast<Derived *>(current_element);
+}
+
+template <typename Derived>
+parlay::sequence<Derived *> ElementBase<Derived>::FlattenLevel(
+    const parlay::sequence<Derived *> &upper_elements, int upper,
+    const Derived *first, int lower) {
+  // Each segment walks `lower` from an element on `upper` up to the next one.
+  // An acyclic list gets an extra segment for its elements before its first
+  // element on `upper`.
+  const bool has_headless_segment{first != nullptr && first->height_ <= upper};
+  const size_t num_segments{has_headless_segment + upper_elements.size()};
+  const auto for_each_in_segment{[&](size_t j, auto f) {
+    const Derived *current_element{
+        has_headless_segment
+            ? (j == 0 ? first : upper_elements[j - 1])
+            : upper_elements[j]};
+    do {
+      f(current_element);
+      current_element = current_element->neighbors_[lower].next;
+    } while (current_element != nullptr && current_element->height_ <= upper);
+  }};
+  parlay::sequence<size_t> offsets(num_segments + 1);
+  parlay::parallel_for(0, num_segments, [&](size_t j) {
+    size_t length{0};
+    for_each_in_segment(j, [&](const Derived *) { length++; });
+    offsets[j] = length;
+  });
+  offsets[num_segments] = 0;
+  const size_t num_elements{parlay::scan_inplace(offsets)};
+  parlay::sequence<Derived *> elements(num_elements);
+  parlay::parallel_for(0, num_segments, [&](size_t j) {
+    size_t k{offsets[j]};
+    for_each_in_segment(j, [&](const Derived *e) {
+      elements[k++] = const_cast<Derived *>(e);
+    });
+  });
+  return elements;
+}
+
+template <typename Derived>
+parlay::sequence<Derived *>
+ElementBase<Derived>::Flatten(const Derived *element) {
+  // The representative is on the top level `top_level`. On an acyclic list it
+  // is the first element on that level.
+  const Derived *representative{element->FindRepresentative()};
+  const int top_level{representative->height_ - 1};
+  const bool is_cycle{representative->neighbors_[top_level].prev != nullptr};
+  const int head_level{std::min(_internal::kFlattenSegmentLevel, top_level)};
+
+  // List the elements on the top level, and then on each level down to
+  // `head_level` from those on the level above, so that each level costs work
+  // linear in its number of elements. Then list all elements from the ones on
+  // `head_level`.
+  parlay::sequence<Derived *> elements;
+  const Derived *current_element{representative};
+  do {
+    elements.push_back(const_cast<Derived *>(current_element));
+    current_element = current_element->neighbors_[top_level].next;
+  } while (current_element != nullptr && current_element != representative);
+  const Derived *first_element{representative};
+  int upper{top_level};
+  for (int level = top_level - 1; level >= 0; level--) {
+    if (!is_cycle) {
+      while (first_element->neighbors_[level].prev != nullptr) {
+        first_element = first_element->neighbors_[level].prev;
+      }
+    }
+    if (level >= head_level || level == 0) {
+      elements = FlattenLevel(elements, upper,
+                              is_cycle ? nullptr : first_element, level);
+      upper = level;
+    }
+  }
+  return elements;
 }
 
 template <typename Derived>
@@ -264,9 +488,14 @@ void ElementBase<Derived>::Join(Derived *left, Derived *right) {
       right = right->FindRightParent(level);
       level++;
     } else {
-      return;
+      break;
     }
   }
+#ifdef PSL_OPERATION_COUNTERS
+  operation_counters::OperationCounts &counts{LocalOperationCounts()};
+  counts.joins++;
+  counts.join_levels += level;
+#endif
 }
 
 template <typename Derived> Derived *ElementBase<Derived>::Split() {
@@ -296,6 +525,11 @@ template <typename Derived> Derived *ElementBase<Derived>::Split() {
       break;
     }
   }
+#ifdef PSL_OPERATION_COUNTERS
+  operation_counters::OperationCounts &counts{LocalOperationCounts()};
+  counts.splits++;
+  counts.split_levels += level;
+#endif
   return successor;
 }
 
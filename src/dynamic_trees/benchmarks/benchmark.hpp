@@ -1,78 +1,48 @@
 #pragma once
 
-#include <cassert>
-#include <fstream>
+#include <algorithm>
+#include <cmath>
+#include <iostream>
 #include <random>
 #include <string>
 #include <utility>
 #include <vector>
 
+#include <dynamic_trees/benchmarks/data/src/graph_io.hpp>
+#include <parlay/parallel.h>
+#include <parlay/random.h>
+#include <psl/perf_counters.hpp>
+#include <psl/utils.h>
 #include <utilities/include/gettime.h>
 #include <utilities/include/parse_command_line.h>
-#include <utilities/include/utils.h>
 
 namespace dynamic_trees_benchmark {
 
-struct ReadGraphOutput {
-  int num_vertices;
-  int num_edges;
-  std::pair<int, int>* edges;
-};
-
-// Returns a list of edges. Stores number of nodes and number of edges in `*np`
-// and `*mp`.
+// Reads a graph in either PBBS adjacency graph format or the binary edge list
+// format described in `graph_io.hpp`. Binary files are memory-mapped rather
+// than copied.
 // Randomly flips edge directions.
-ReadGraphOutput ReadGraph(char* graph_filename) {
-  std::ifstream infile;
-  infile.open(graph_filename);
-  struct ReadGraphOutput output;
-
-  string input_type;
-  infile >> input_type;
-  assert(input_type == "AdjacencyGraph");
-  infile >> output.num_vertices >> output.num_edges;
-  output.num_edges /= 2;  // symmetric graph
-  const int n{output.num_vertices}, m{output.num_edges};
-  output.edges = pbbs::new_array_no_init<pair<int, int>>(m);
-
-  int* offsets{pbbs::new_array_no_init<int>(n)};
-  for (int i = 0; i < n; i++) {
-    infile >> offsets[i];
-  }
-
-  std::uniform_int_distribution<int> coin{0, 1};
-  std::mt19937 generator{0};
-  int curr_vert{0};
-  int edges_index{0};
-  for (int i = 0; i < 2 * m; i++) {
-    while (curr_vert < n - 1 && offsets[curr_vert + 1] == i) {
-      curr_vert++;
-    }
-    int v;
-    infile >> v;
-    if (curr_vert < v) {  // don't want to read both directions of edge
-      // randomly swap direction of edge
-      if (coin(generator)) {
-        output.edges[edges_index++] = std::make_pair(curr_vert, v);
-      } else {
-        output.edges[edges_index++] = std::make_pair(v, curr_vert);
-      }
+EdgeList ReadGraph(char* graph_filename) {
+  EdgeList graph{ReadEdgeList(graph_filename)};
+  parlay::random randomness{};
+  parlay::parallel_for(0, graph.num_edges, [&](size_t i) {
+    if (randomness.ith_rand(i) & 1) {
+      std::swap(graph.edges[i].first, graph.edges[i].second);
     }
-  }
-
-  pbbs::delete_array(offsets, n);
-  infile.close();
-  return output;
+  });
+  return graph;
 }
 
 // For `num_iters` iterations, construct a forest from the `m` edges in `edges`,
 // then batch cut and batch link the first `batch_size` edges in `edges`.
-// Report the median batch cut and batch link time.
+// Report the median batch cut and batch link time and, if enabled, the
+// performance counters of their phases averaged over the iterations.
 template <typename Forest>
 void UpdateForest(Forest* forest, std::pair<int, int>* edges,
     int batch_size, int num_iters, int m) {
-  vector<double> cut_times(num_iters);
-  vector<double> link_times(num_iters);
+  std::vector<double> cut_times(num_iters);
+  std::vector<double> link_times(num_iters);
+  std::vector<perf_counters::PhaseCounts> phase_counts;
 
   for (int j = 0; j < num_iters; j++) {
     if (m == batch_size) {
@@ -86,8 +56,11 @@ void UpdateForest(Forest* forest, std::pair<int, int>* edges,
       timer cut_t; cut_t.start();
       forest->BatchCut(edges, batch_size);
       cut_times[j] = cut_t.stop();
+      perf_counters::AddPhaseCounts(
+          &phase_counts, perf_counters::TakePhaseCounts());
     } else {
       forest->BatchLink(edges, m);  // construct
+      perf_counters::TakePhaseCounts();
 
       timer cut_t; cut_t.start();
       forest->BatchCut(edges, batch_size);
@@ -96,28 +69,232 @@ void UpdateForest(Forest* forest, std::pair<int, int>* edges,
       timer link_t; link_t.start();
       forest->BatchLink(edges, batch_size);
       link_times[j] = link_t.stop();
+      perf_counters::AddPhaseCounts(
+          &phase_counts, perf_counters::TakePhaseCounts());
 
       forest->BatchCut(edges, m);  // destruct
+      perf_counters::TakePhaseCounts();
     }
   }
-  const string batch_str{to_string(batch_size)};
+  const std::string batch_str{std::to_string(batch_size)};
   timer::report_time_no_newline("link-" + batch_str, median(link_times));
   timer::report_time("cut-" + batch_str, median(cut_times));
+  perf_counters::ReportPhaseCounts(std::cout, phase_counts, num_iters);
+}
+
+// One step of a mixed workload: a batch of cuts, then a batch of links, then a
+// batch of connectivity queries.
+struct WorkloadStep {
+  std::vector<std::pair<int, int>> cuts;
+  std::vector<std::pair<int, int>> links;
+  std::vector<std::pair<int, int>> queries;
+};
+
+// The workloads below link and cut subsets of the edges of the input forest.
+// Every subset of a forest is a forest, so no link creates a cycle.
+
+// Keeps a window of `window_size` consecutive edges of `edges` (taken
+// cyclically) in the forest. Each step slides the window forward by the batch
+// size, cutting the oldest edges and linking the newest ones.
+class SlidingWindowWorkload {
+ public:
+  SlidingWindowWorkload(std::pair<int, int>* edges, int m, int window_size)
+      : edges_{edges}, m_{m}, window_size_{window_size} {}
+
+  // Returns the largest batch size this workload supports. A step cannot cut
+  // more edges than the window holds or link edges that are still in it.
+  int MaxBatchSize() const { return std::min(window_size_, m_ - window_size_); }
+
+  std::vector<std::pair<int, int>> InitialLinks() {
+    window_start_ = 0;
+    return {edges_, edges_ + window_size_};
+  }
+
+  void NextStep(int batch_size, WorkloadStep* step) {
+    step->cuts.resize(batch_size);
+    step->links.resize(batch_size);
+    for (int i = 0; i < batch_size; i++) {
+      step->cuts[i] = edges_[(window_start_ + i) % m_];
+      step->links[i] = edges_[(window_start_ + window_size_ + i) % m_];
+    }
+    window_start_ = (window_start_ + batch_size) % m_;
+  }
+
+ private:
+  std::pair<int, int>* edges_;
+  int m_;
+  int window_size_;
+  int window_start_{0};
+};
+
+// Starts with each edge of `edges` in the forest with probability 1/2. Each step
+// picks `batch_size` distinct edges uniformly at random and flips whether each
+// is in the forest.
+class EdgeFlipWorkload {
+ public:
+  EdgeFlipWorkload(std::pair<int, int>* edges, int m)
+      : edges_{edges}, m_{m}, in_forest_(m), chosen_(m), generator_{0} {}
+
+  int MaxBatchSize() const { return m_ / 2; }
+
+  std::vector<std::pair<int, int>> InitialLinks() {
+    std::vector<std::pair<int, int>> links;
+    std::bernoulli_distribution coin{0.5};
+    for (int i = 0; i < m_; i++) {
+      in_forest_[i] = coin(generator_);
+      if (in_forest_[i]) {
+        links.push_back(edges_[i]);
+      }
+    }
+    return links;
+  }
+
+  void NextStep(int batch_size, WorkloadStep* step) {
+    std::uniform_int_distribution<int> edge_distribution{0, m_ - 1};
+    std::vector<int> flips;
+    while (static_cast<int>(flips.size()) < batch_size) {
+      const int i{edge_distribution(generator_)};
+      if (!chosen_[i]) {
+        chosen_[i] = true;
+        flips.push_back(i);
+      }
+    }
+    step->cuts.clear();
+    step->links.clear();
+    for (int i : flips) {
+      chosen_[i] = false;
+      (in_forest_[i] ? step->cuts : step->links).push_back(edges_[i]);
+      in_forest_[i] = !in_forest_[i];
+    }
+  }
+
+ private:
+  std::pair<int, int>* edges_;
+  int m_;
+  std::vector<bool> in_forest_;
+  std::vector<bool> chosen_;
+  std::mt19937 generator_;
+};
+
+// Returns the `quantile`-th quantile of `times`, rounding up to the nearest
+// sample.
+double Quantile(std::vector<double> times, double quantile) {
+  std::sort(times.begin(), times.end());
+  const size_t rank{static_cast<size_t>(std::ceil(quantile * times.size()))};
+  return times[std::min(std::max(rank, size_t{1}), times.size()) - 1];
 }
 
+// Replays `num_steps` steps of `workload` with batch size `batch_size` on a
+// fresh forest, each step followed by `queries_per_update` times as many
+// connectivity queries on uniformly random vertex pairs. The first
+// `num_warmup_steps` steps are not timed. Reports the sustained throughput in
+// operations per second and the 50th, 99th, and 99.9th percentile latencies of
+// a step and, if enabled, the performance counters of the phases of the batch
+// operations averaged over the timed steps.
+template <typename Forest, typename Workload>
+void RunMixedWorkload(Workload* workload, int num_vertices, int batch_size,
+    int num_steps, int num_warmup_steps, double queries_per_update) {
+  Forest forest{num_vertices};
+  std::vector<std::pair<int, int>> initial_links{workload->InitialLinks()};
+  forest.BatchLink(initial_links.data(), initial_links.size());
+
+  std::mt19937 generator{0};
+  std::uniform_int_distribution<int> vertex_distribution{0, num_vertices - 1};
+  WorkloadStep step{};
+  std::vector<double> step_times;
+  double total_time{0.0};
+  long long total_ops{0};
+  std::vector<perf_counters::PhaseCounts> phase_counts;
+  perf_counters::TakePhaseCounts();
+  for (int j = 0; j < num_warmup_steps + num_steps; j++) {
+    workload->NextStep(batch_size, &step);
+    step.queries.resize(static_cast<size_t>(queries_per_update * batch_size));
+    for (auto& query : step.queries) {
+      query = std::make_pair(
+          vertex_distribution(generator), vertex_distribution(generator));
+    }
+
+    timer step_t; step_t.start();
+    forest.BatchCut(step.cuts.data(), step.cuts.size());
+    forest.BatchLink(step.links.data(), step.links.size());
+    bool* connected{
+        forest.BatchConnected(step.queries.data(), step.queries.size())};
+    const double step_time{step_t.stop()};
+    delete[] connected;
+
+    if (j >= num_warmup_steps) {
+      step_times.push_back(step_time);
+      total_time += step_time;
+      total_ops += step.cuts.size() + step.links.size() + step.queries.size();
+      perf_counters::AddPhaseCounts(
+          &phase_counts, perf_counters::TakePhaseCounts());
+    } else {
+      perf_counters::TakePhaseCounts();
+    }
+  }
+
+  std::cout << "mixed-" << batch_size << " : "
+            << (total_time > 0 ? total_ops / total_time : 0) << " ops/s"
+            << " p50 " << Quantile(step_times, 0.5)
+            << " p99 " << Quantile(step_times, 0.99)
+            << " p999 " << Quantile(step_times, 0.999) << std::endl;
+  perf_counters::ReportPhaseCounts(std::cout, phase_counts, num_steps);
+}
+
+// Runs `RunMixedWorkload` on batch sizes 100, 1000, ... up to the largest that
+// `workload` supports.
+template <typename Forest, typename Workload>
+void RunMixedWorkloads(Workload* workload, int num_vertices, int num_steps,
+    int num_warmup_steps, double queries_per_update) {
+  const int max_batch_size{workload->MaxBatchSize()};
+  for (int batch_size = 100; batch_size <= max_batch_size; batch_size *= 10) {
+    RunMixedWorkload<Forest>(workload, num_vertices, batch_size, num_steps,
+        num_warmup_steps, queries_per_update);
+  }
+}
+
+// With `-workload batch` (the default), times batch cuts and batch links as
+// described for `UpdateForest`. With `-workload sliding-window` or `-workload
+// edge-flip`, replays a stream of cuts, links, and queries instead as described
+// for `RunMixedWorkload`.
 template <typename Forest>
 void RunBenchmark(int argc, char** argv) {
-  commandLine P{argc, argv, "[-iters] graph_filename"};
+  commandLine P{argc, argv,
+      "[-iters] [-workload (batch|sliding-window|edge-flip)] [-steps] "
+      "[-warmup-steps] [-queries-per-update] [-window] graph_filename"};
   int num_iters{P.getOptionIntValue("-iters", 4)};
+  const std::string workload_type{P.getOptionValue("-workload", "batch")};
   char* graph_filename{P.getArgument(0)};
 
-  std::cout << "Running with " << nworkers() << " workers" << std::endl;
-  ReadGraphOutput graph_info{ReadGraph(graph_filename)};
+  std::cout << "Running with " << parlay::num_workers() << " workers" << std::endl;
+  perf_counters::Initialize();
+  EdgeList graph_info{ReadGraph(graph_filename)};
   const int m{graph_info.num_edges};
   std::pair<int, int>* edges{graph_info.edges};
   std::mt19937 generator{0};
   std::shuffle(edges, edges + m, generator);
 
+  if (workload_type != "batch") {
+    const int num_steps{P.getOptionIntValue("-steps", 100)};
+    const int num_warmup_steps{P.getOptionIntValue("-warmup-steps", 10)};
+    const double queries_per_update{
+        P.getOptionDoubleValue("-queries-per-update", 1.0)};
+    if (workload_type == "sliding-window") {
+      SlidingWindowWorkload workload{
+          edges, m, P.getOptionIntValue("-window", m / 2)};
+      RunMixedWorkloads<Forest>(&workload, graph_info.num_vertices,
+          num_steps, num_warmup_steps, queries_per_update);
+    } else if (workload_type == "edge-flip") {
+      EdgeFlipWorkload workload{edges, m};
+      RunMixedWorkloads<Forest>(&workload, graph_info.num_vertices,
+          num_steps, num_warmup_steps, queries_per_update);
+    } else {
+      P.badArgument();
+    }
+    FreeEdgeList(&graph_info);
+    return;
+  }
+
   Forest forest{graph_info.num_vertices};
 
   for (int batch_size = 100; batch_size < m; batch_size *= 10) {
@@ -125,7 +302,7 @@ void RunBenchmark(int argc, char** argv) {
   }
   UpdateForest(&forest, edges, m, num_iters, m);
 
-  pbbs::delete_array(edges, m);
+  FreeEdgeList(&graph_info);
 }
 
 }  // namespace dynamic_trees_benchmark
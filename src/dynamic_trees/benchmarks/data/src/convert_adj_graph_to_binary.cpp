@@ -0,0 +1,16 @@
+#include <utility>
+
+#include <dynamic_trees/benchmarks/data/src/graph_io.hpp>
+#include <utilities/include/parse_command_line.h>
+
+// Converts a graph from PBBS adjacency graph format to the binary edge list
+// format described in `graph_io.hpp`.
+int main(int argc, char* argv[]) {
+  commandLine P{argc, argv, "<inFile> <outFile>"};
+  pair<char*, char*> filenames{P.IOFileNames()};
+
+  EdgeList graph{ParseAdjGraph(filenames.first)};
+  WriteBinaryEdgeList(graph, filenames.second);
+  FreeEdgeList(&graph);
+  return 0;
+}
@@ -0,0 +1,243 @@
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/benchmarks/data/src/graph_io.hpp>
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/random.h>
+#include <parlay/slice.h>
+#include <psl/utils.h>
+#include <utilities/include/parse_command_line.h>
+
+typedef long long ll;
+using std::string;
+using std::vector;
+
+namespace {
+
+// Edges are generated and written out this many vertices at a time.
+constexpr ll kBlockLength{1 << 22};
+// Component sizes for random forests are drawn this many at a time.
+constexpr ll kComponentBatchLength{1 << 20};
+
+const char kUsage[] =
+    "-shape <shape> [-seed <seed>] [-spine-length <length>] "
+    "[-handle-length <length>] [-component-sizes <distribution>] n <outFile>\n"
+    "  shapes: path, star, binary_tree, recursive_tree, caterpillar, broom,\n"
+    "          preferential_attachment, random_forest\n"
+    "  distributions: fixed:<size>, uniform:<min>:<max>,\n"
+    "                 power_law:<exponent>:<max>";
+
+void Fail(const string& message) {
+  std::cerr << message << std::endl;
+  exit(1);
+}
+
+// Returns a uniformly random double in [0, 1).
+inline double ToUnitInterval(size_t r) {
+  return (r >> 11) * (1.0 / (1ULL << 53));
+}
+
+// Draws component sizes in parallel from a distribution given as a string like
+// "power_law:2.5:1000".
+class ComponentSizeDistribution {
+ public:
+  explicit ComponentSizeDistribution(const string& spec) {
+    double a, b;
+    if (sscanf(spec.c_str(), "fixed:%lf", &a) == 1) {
+      min_ = max_ = a;
+      exponent_ = 0;
+    } else if (sscanf(spec.c_str(), "uniform:%lf:%lf", &a, &b) == 2) {
+      min_ = a;
+      max_ = b;
+      exponent_ = 0;
+    } else if (sscanf(spec.c_str(), "power_law:%lf:%lf", &a, &b) == 2) {
+      min_ = 1;
+      max_ = b;
+      exponent_ = a;
+      if (exponent_ <= 1) {
+        Fail("Power law exponent must be greater than 1");
+      }
+    } else {
+      Fail("Unrecognized component size distribution: " + spec);
+    }
+    if (min_ < 1 || max_ < min_) {
+      Fail("Invalid component sizes: " + spec);
+    }
+  }
+
+  ll Sample(size_t r) const {
+    const double u{ToUnitInterval(r)};
+    if (exponent_ == 0) {
+      return min_ + static_cast<ll>(u * (max_ - min_ + 1));
+    }
+    // Invert the CDF of a continuous power law truncated to [1, max + 1), then
+    // round down. This gives P(size = s) roughly proportional to s^-exponent.
+    const double e{1 - exponent_};
+    const double x{pow(1 - u * (1 - pow(max_ + 1, e)), 1 / e)};
+    return std::min(static_cast<ll>(x), max_);
+  }
+
+ private:
+  ll min_;
+  ll max_;
+  double exponent_;
+};
+
+// Splits vertices [0, n) into consecutive components with sizes drawn from
+// `distribution`, returning the first vertex of each component. The last
+// component is truncated to fit.
+vector<ll> DrawComponentStarts(
+    ll n, const ComponentSizeDistribution& distribution, parlay::random rng) {
+  vector<ll> starts;
+  ll* offsets{new_array_no_init<ll>(kComponentBatchLength)};
+  ll next_start{0};
+  for (ll round = 0; next_start < n; round++) {
+    // Every component has at least one vertex, so this batch is large enough
+    // to reach n if it is the last one.
+    const ll batch_length{std::min(kComponentBatchLength, n - next_start)};
+    parlay::random round_rng{rng.fork(round)};
+    parlay::parallel_for(0, batch_length, [&](ll i) {
+      offsets[i] = distribution.Sample(round_rng.ith_rand(i));
+    });
+    const ll batch_size{parlay::scan_inplace(
+        parlay::make_slice(offsets, offsets + batch_length))};
+    for (ll i = 0; i < batch_length && next_start + offsets[i] < n; i++) {
+      starts.push_back(next_start + offsets[i]);
+    }
+    next_start += batch_size;
+  }
+  delete_array(offsets, kComponentBatchLength);
+  return starts;
+}
+
+// Writes a forest on vertices [0, n) in which `roots` (sorted) are exactly the
+// vertices without a parent and every other vertex i has parent
+// `get_parent(i)`. `get_parent` must be deterministic so that blocks of
+// vertices can be generated independently and in parallel.
+template <typename ParentFunction>
+void WriteForest(
+    ll n,
+    const vector<ll>& roots,
+    ParentFunction get_parent,
+    const string& filename) {
+  BinaryEdgeListWriter writer{filename, n};
+  std::pair<int, int>* edges{
+      new_array_no_init<std::pair<int, int>>(kBlockLength)};
+  // Vertex i's edge goes in position (i - number of roots <= i).
+  auto edge_index = [&](ll i) {
+    return i - (std::upper_bound(roots.begin(), roots.end(), i) - roots.begin());
+  };
+  for (ll block_start = 0; block_start < n; block_start += kBlockLength) {
+    const ll block_end{std::min(block_start + kBlockLength, n)};
+    const ll first_edge{edge_index(block_start - 1) + 1};
+    parlay::parallel_for(block_start, block_end, [&](ll i) {
+      if (!std::binary_search(roots.begin(), roots.end(), i)) {
+        edges[edge_index(i) - first_edge] =
+            std::make_pair(static_cast<int>(i),
+                           static_cast<int>(get_parent(i)));
+      }
+    });
+    writer.Write(edges, edge_index(block_end - 1) + 1 - first_edge);
+  }
+  delete_array(edges, kBlockLength);
+}
+
+}  // namespace
+
+// Generates large forests in parallel, writing them directly in the binary edge
+// list format (see `graph_io.hpp`). Every shape is described by a function
+// giving the parent of each vertex, computed from a hash of the vertex ID so
+// that vertices can be generated in any order.
+//
+// - path: i's parent is i - 1.
+// - star: i's parent is 0.
+// - binary_tree: i's parent is (i - 1) / 2.
+// - recursive_tree: i's parent is uniformly random from [0, i).
+// - caterpillar: a path on the first `-spine-length` vertices (default n / 2),
+//   with each other vertex attached to a uniformly random spine vertex.
+// - broom: a path on the first `-handle-length` vertices (default n / 2), with
+//   each other vertex attached to the end of the path.
+// - preferential_attachment: i attaches to an endpoint of a uniformly random
+//   edge among the first i - 1 edges, so that it attaches to each existing
+//   vertex with probability proportional to that vertex's degree.
+// - random_forest: vertices are split into consecutive components with sizes
+//   drawn from `-component-sizes` (default power_law:2.5:n), and each component
+//   is a recursive tree.
+int main(int argc, char* argv[]) {
+  commandLine P{argc, argv, kUsage};
+  const ll n{atoll(P.getArgument(1))};
+  const string filename{P.getArgument(0)};
+  const string shape{P.getOptionValue("-shape", "")};
+  parlay::random rng{
+      static_cast<size_t>(P.getOptionLongValue("-seed", 0))};
+  if (n < 1 || n > INT_MAX) {
+    Fail("Number of vertices must be in [1, " + std::to_string(INT_MAX) + "]");
+  }
+
+  const vector<ll> single_root{0};
+  if (shape == "path") {
+    WriteForest(n, single_root, [](ll i) { return i - 1; }, filename);
+  } else if (shape == "star") {
+    WriteForest(n, single_root, [](ll) { return 0LL; }, filename);
+  } else if (shape == "binary_tree") {
+    WriteForest(n, single_root, [](ll i) { return (i - 1) / 2; }, filename);
+  } else if (shape == "recursive_tree") {
+    WriteForest(n, single_root,
+        [&](ll i) { return static_cast<ll>(rng.ith_rand(i) % i); }, filename);
+  } else if (shape == "caterpillar") {
+    const ll spine_length{std::max(1L, P.getOptionLongValue(
+        "-spine-length", std::max(1LL, n / 2)))};
+    WriteForest(n, single_root,
+        [&](ll i) {
+          return i < spine_length
+            ? i - 1
+            : static_cast<ll>(rng.ith_rand(i) % spine_length);
+        },
+        filename);
+  } else if (shape == "broom") {
+    const ll handle_length{std::max(1L, P.getOptionLongValue(
+        "-handle-length", std::max(1LL, n / 2)))};
+    WriteForest(n, single_root,
+        [&](ll i) { return std::min(i, handle_length) - 1; }, filename);
+  } else if (shape == "preferential_attachment") {
+    // Identify each edge by its child endpoint, so the first i - 1 edges are
+    // identified by [1, i). Picking an endpoint of edge e means picking either
+    // e itself or e's parent, the latter of which is computed the same way.
+    WriteForest(n, single_root,
+        [&](ll i) {
+          ll child{i};
+          while (child > 1) {
+            const size_t r{rng.ith_rand(child)};
+            const ll edge{1 + static_cast<ll>((r >> 1) % (child - 1))};
+            if (r & 1) {
+              return edge;
+            }
+            child = edge;
+          }
+          return 0LL;
+        },
+        filename);
+  } else if (shape == "random_forest") {
+    const ComponentSizeDistribution distribution{P.getOptionValue(
+        "-component-sizes", "power_law:2.5:" + std::to_string(n))};
+    const vector<ll> roots{
+        DrawComponentStarts(n, distribution, rng.fork(1))};
+    WriteForest(n, roots,
+        [&](ll i) {
+          const ll root{*(std::upper_bound(roots.begin(), roots.end(), i) - 1)};
+          return root + static_cast<ll>(rng.ith_rand(i) % (i - root));
+        },
+        filename);
+  } else {
+    Fail("Unrecognized shape: " + shape + "\nUsage: " + kUsage);
+  }
+  return 0;
+}
@@ -1,12 +1,88 @@
 #include <dynamic_trees/benchmarks/data/src/graph_io.hpp>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iostream>
 #include <vector>
 
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/slice.h>
+#include <psl/utils.h>
+
 typedef long long ll;
 using std::vector;
 
-void PrintAdjGraph(vector<vector<ll>> adj_list, std::string filename) {
+namespace {
+
+// Each chunk of an adjacency graph file is tokenized and parsed by one task.
+constexpr size_t kParseChunkLength{1 << 20};
+
+void Fail(const std::string& message, const std::string& filename) {
+  std::cerr << message << ": " << filename << std::endl;
+  exit(1);
+}
+
+// Maps the whole file into memory. If `writable` is true, the mapping is a
+// private copy-on-write mapping that may be written to.
+void* MapFile(const std::string& filename, bool writable, size_t* length) {
+  const int fd{open(filename.c_str(), O_RDONLY)};
+  if (fd == -1) {
+    Fail("Cannot open file", filename);
+  }
+  struct stat file_stats;
+  if (fstat(fd, &file_stats) == -1) {
+    Fail("Cannot stat file", filename);
+  }
+  *length = file_stats.st_size;
+  void* mapping{mmap(nullptr, *length,
+      writable ? PROT_READ | PROT_WRITE : PROT_READ, MAP_PRIVATE, fd, 0)};
+  if (mapping == MAP_FAILED) {
+    Fail("Cannot map file", filename);
+  }
+  close(fd);
+  return mapping;
+}
+
+inline bool IsSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r';
+}
+
+inline bool IsTokenStart(const char* text, size_t i) {
+  return !IsSpace(text[i]) && (i == 0 || IsSpace(text[i - 1]));
+}
+
+// Parses the nonnegative integer starting at `text[*position]` and moves
+// `*position` past it.
+inline ll ParseInteger(const char* text, size_t length, size_t* position) {
+  ll value{0};
+  size_t i{*position};
+  while (i < length && text[i] >= '0' && text[i] <= '9') {
+    value = 10 * value + (text[i] - '0');
+    i++;
+  }
+  *position = i;
+  return value;
+}
+
+// Moves `*position` to the start of the next token.
+inline void SkipSpaces(const char* text, size_t length, size_t* position) {
+  while (*position < length && IsSpace(text[*position])) {
+    (*position)++;
+  }
+}
+
+}  // namespace
+
+void PrintAdjGraph(const vector<vector<ll>>& adj_list, std::string filename) {
   std::ofstream file;
   file.open(filename);
   ll n{static_cast<ll>(adj_list.size())};
@@ -21,7 +97,7 @@ void PrintAdjGraph(vector<vector<ll>> adj_list, std::string filename) {
     file << offset << '\n';
     offset += adj_list[i].size();
   }
-  for (auto vec : adj_list) {
+  for (const auto& vec : adj_list) {
     for (auto v : vec) {
       file << v << '\n';
     }
@@ -30,3 +106,178 @@ void PrintAdjGraph(vector<vector<ll>> adj_list, std::string filename) {
   file.close();
 }
 
+bool IsBinaryEdgeListFile(const std::string& filename) {
+  std::ifstream file{filename, std::ios::binary};
+  char magic[sizeof(kBinaryEdgeListMagic)];
+  file.read(magic, sizeof(magic));
+  return file.gcount() == sizeof(magic) &&
+    memcmp(magic, kBinaryEdgeListMagic, sizeof(magic)) == 0;
+}
+
+EdgeList MapBinaryEdgeList(const std::string& filename) {
+  EdgeList graph{};
+  char* bytes{static_cast<char*>(
+      MapFile(filename, true, &graph.mapping_length))};
+  graph.mapping = bytes;
+  if (graph.mapping_length < kBinaryEdgeListHeaderLength ||
+      memcmp(bytes, kBinaryEdgeListMagic, sizeof(kBinaryEdgeListMagic)) != 0) {
+    Fail("Not a binary edge list file", filename);
+  }
+  uint64_t num_vertices, num_edges;
+  memcpy(&num_vertices, bytes + 8, sizeof(num_vertices));
+  memcpy(&num_edges, bytes + 16, sizeof(num_edges));
+  if (graph.mapping_length !=
+      kBinaryEdgeListHeaderLength + num_edges * sizeof(std::pair<int, int>)) {
+    Fail("Truncated binary edge list file", filename);
+  }
+  graph.num_vertices = num_vertices;
+  graph.num_edges = num_edges;
+  graph.edges = reinterpret_cast<std::pair<int, int>*>(
+      bytes + kBinaryEdgeListHeaderLength);
+  return graph;
+}
+
+void WriteBinaryEdgeList(const EdgeList& graph, const std::string& filename) {
+  BinaryEdgeListWriter writer{filename, graph.num_vertices};
+  writer.Write(graph.edges, graph.num_edges);
+}
+
+BinaryEdgeListWriter::BinaryEdgeListWriter(
+    const std::string& filename, long long num_vertices)
+    : filename_{filename}, num_vertices_{num_vertices}, num_edges_{0} {
+  file_ = fopen(filename.c_str(), "wb");
+  if (file_ == nullptr) {
+    Fail("Cannot open file", filename);
+  }
+  // Leave room for the header, which is written on destruction.
+  fseek(file_, kBinaryEdgeListHeaderLength, SEEK_SET);
+}
+
+BinaryEdgeListWriter::~BinaryEdgeListWriter() {
+  const uint64_t num_vertices = num_vertices_;
+  const uint64_t num_edges = num_edges_;
+  fseek(file_, 0, SEEK_SET);
+  fwrite(kBinaryEdgeListMagic, sizeof(kBinaryEdgeListMagic), 1, file_);
+  fwrite(&num_vertices, sizeof(num_vertices), 1, file_);
+  fwrite(&num_edges, sizeof(num_edges), 1, file_);
+  if (fclose(file_) != 0) {
+    Fail("Cannot write file", filename_);
+  }
+}
+
+void BinaryEdgeListWriter::Write(const std::pair<int, int>* edges, size_t len) {
+  if (fwrite(edges, sizeof(std::pair<int, int>), len, file_) != len) {
+    Fail("Cannot write file", filename_);
+  }
+  num_edges_ += len;
+}
+
+// Implementation: split the text after the header into fixed-length chunks,
+// count the tokens starting in each chunk in parallel, prefix sum the counts,
+// and then parse each chunk's tokens into place in parallel.
+EdgeList ParseAdjGraph(const std::string& filename) {
+  size_t length;
+  const char* text{static_cast<const char*>(MapFile(filename, false, &length))};
+
+  size_t position{0};
+  SkipSpaces(text, length, &position);
+  if (length - position < 14 ||
+      strncmp(text + position, "AdjacencyGraph", 14) != 0) {
+    Fail("Not an adjacency graph file", filename);
+  }
+  position += 14;
+  SkipSpaces(text, length, &position);
+  const ll n{ParseInteger(text, length, &position)};
+  SkipSpaces(text, length, &position);
+  const ll m{ParseInteger(text, length, &position)};
+  const size_t body_start{position};
+
+  // Tokens [0, n) of the body are offsets and tokens [n, n + m) are
+  // adjacencies.
+  const size_t num_chunks{
+      (length - body_start + kParseChunkLength - 1) / kParseChunkLength};
+  size_t* chunk_offsets{new_array_no_init<size_t>(num_chunks)};
+  parlay::parallel_for(0, num_chunks, [&](size_t i) {
+    const size_t start{body_start + i * kParseChunkLength};
+    const size_t end{std::min(start + kParseChunkLength, length)};
+    size_t count{0};
+    for (size_t j = start; j < end; j++) {
+      count += IsTokenStart(text, j);
+    }
+    chunk_offsets[i] = count;
+  });
+  const size_t num_tokens{parlay::scan_inplace(
+      parlay::make_slice(chunk_offsets, chunk_offsets + num_chunks))};
+  if (num_tokens != static_cast<size_t>(n + m)) {
+    Fail("Malformed adjacency graph file", filename);
+  }
+
+  ll* offsets{new_array_no_init<ll>(n + 1)};
+  int* adjacencies{new_array_no_init<int>(m)};
+  parlay::parallel_for(0, num_chunks, [&](size_t i) {
+    const size_t start{body_start + i * kParseChunkLength};
+    const size_t end{std::min(start + kParseChunkLength, length)};
+    size_t token_index{chunk_offsets[i]};
+    for (size_t j = start; j < end; j++) {
+      if (IsTokenStart(text, j)) {
+        size_t token_end{j};
+        const ll value{ParseInteger(text, length, &token_end)};
+        if (token_index < static_cast<size_t>(n)) {
+          offsets[token_index] = value;
+        } else {
+          adjacencies[token_index - n] = value;
+        }
+        token_index++;
+      }
+    }
+  });
+  offsets[n] = m;
+  delete_array(chunk_offsets, num_chunks);
+  munmap(const_cast<char*>(text), length);
+
+  // Keep edge (u, v) only if u < v so that each edge appears once.
+  size_t* edge_offsets{new_array_no_init<size_t>(n)};
+  parlay::parallel_for(0, n, [&](ll u) {
+    size_t count{0};
+    for (ll i = offsets[u]; i < offsets[u + 1]; i++) {
+      count += u < adjacencies[i];
+    }
+    edge_offsets[u] = count;
+  });
+  const size_t num_edges{parlay::scan_inplace(
+      parlay::make_slice(edge_offsets, edge_offsets + n))};
+
+  EdgeList graph{};
+  graph.num_vertices = n;
+  graph.num_edges = num_edges;
+  graph.edges = new_array_no_init<std::pair<int, int>>(num_edges);
+  parlay::parallel_for(0, n, [&](ll u) {
+    size_t edge_index{edge_offsets[u]};
+    for (ll i = offsets[u]; i < offsets[u + 1]; i++) {
+      if (u < adjacencies[i]) {
+        graph.edges[edge_index++] = std::make_pair(u, adjacencies[i]);
+      }
+    }
+  });
+
+  delete_array(edge_offsets, n);
+  delete_array(adjacencies, m);
+  delete_array(offsets, n + 1);
+  return graph;
+}
+
+EdgeList ReadEdgeList(const std::string& filename) {
+  return IsBinaryEdgeListFile(filename)
+    ? MapBinaryEdgeList(filename)
+    : ParseAdjGraph(filename);
+}
+
+void FreeEdgeList(EdgeList* graph) {
+  if (graph->mapping != nullptr) {
+    munmap(graph->mapping, graph->mapping_length);
+  } else {
+    delete_array(graph->edges, graph->num_edges);
+  }
+  graph->edges = nullptr;
+  graph->mapping = nullptr;
+}
@@ -1,8 +1,77 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdio>
 #include <string>
+#include <utility>
 #include <vector>
 
 // Prints adjacency list in PBBS adjacency graph format
 void PrintAdjGraph(
-    std::vector<std::vector<long long>> adj_list, std::string filename);
+    const std::vector<std::vector<long long>>& adj_list, std::string filename);
+
+// An undirected graph stored as a list of edges in which each edge appears
+// once.
+struct EdgeList {
+  int num_vertices;
+  int num_edges;
+  std::pair<int, int>* edges;
+
+  // If `edges` points into a memory-mapped file, this is the start and length
+  // of the mapping. Otherwise `mapping` is null and `edges` was allocated with
+  // `new_array_no_init`.
+  void* mapping;
+  size_t mapping_length;
+};
+
+// Binary edge list format:
+//   8 bytes: `kBinaryEdgeListMagic`
+//   8 bytes: number of vertices as a little-endian uint64
+//   8 bytes: number of edges m as a little-endian uint64
+//   8m bytes: the edges as pairs of little-endian int32 vertex IDs
+// Since the header is a multiple of 8 bytes long, the edges may be used
+// directly from a memory mapping of the file.
+constexpr char kBinaryEdgeListMagic[8]{'E', 'D', 'G', 'E', 'L', 'S', 'T', '1'};
+constexpr size_t kBinaryEdgeListHeaderLength{24};
+
+// Returns true if the file starts with `kBinaryEdgeListMagic`.
+bool IsBinaryEdgeListFile(const std::string& filename);
+
+// Maps a binary edge list file into memory without copying it. The mapping is
+// private and writable: writing to the edges modifies only this process's copy
+// of the pages that are written to.
+EdgeList MapBinaryEdgeList(const std::string& filename);
+
+// Writes `graph` in the binary edge list format.
+void WriteBinaryEdgeList(const EdgeList& graph, const std::string& filename);
+
+// Writes a graph in the binary edge list format a batch of edges at a time, so
+// that the whole edge list need not be held in memory. The header is completed
+// when the writer is destroyed.
+class BinaryEdgeListWriter {
+ public:
+  BinaryEdgeListWriter(const std::string& filename, long long num_vertices);
+  ~BinaryEdgeListWriter();
+  BinaryEdgeListWriter(const BinaryEdgeListWriter&) = delete;
+  BinaryEdgeListWriter& operator=(const BinaryEdgeListWriter&) = delete;
+
+  void Write(const std::pair<int, int>* edges, size_t len);
+
+ private:
+  std::string filename_;
+  FILE* file_;
+  long long num_vertices_;
+  long long num_edges_;
+};
+
+// Reads a graph in PBBS adjacency graph format. The file is split into chunks
+// that are tokenized and parsed in parallel. Each edge {u, v} is returned once
+// as (min(u, v), max(u, v)).
+EdgeList ParseAdjGraph(const std::string& filename);
+
+// Reads a graph in either the binary edge list format or the PBBS adjacency
+// graph format, detecting which from the start of the file.
+EdgeList ReadEdgeList(const std::string& filename);
+
+// Releases the memory held by `graph`.
+void FreeEdgeList(EdgeList* graph);
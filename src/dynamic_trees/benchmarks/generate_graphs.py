@@ -3,12 +3,16 @@ import subprocess
 
 num_vertices = [10000000]
 graphs = ["binary_tree", "path", "recursive_tree", "star"]
+# Shapes generated by `generate_forest` directly in binary edge list format.
+forest_shapes = ["caterpillar", "broom", "preferential_attachment",
+                 "random_forest"]
 output_directory = "data/graphs/"
 
-subprocess.check_call(["make"])
+# The generators are built by CMake into `build/bin/` (see the top-level
+# README).
 bin_directory = \
     subprocess.check_output(['git', 'rev-parse', '--show-toplevel'])[:-1]  \
-        + '/bin'
+        + '/build/bin'
 
 for n in num_vertices:
     for graph in graphs:
@@ -17,3 +21,10 @@ for n in num_vertices:
         print binary_name, output_name
         subprocess.check_call([binary_name, str(n), output_name])
         print "generated " + graph + " " + str(n)
+    for shape in forest_shapes:
+        binary_name = bin_directory + "/generate_forest"
+        output_name = output_directory + shape + "_" + str(n) + ".bin"
+        print binary_name, output_name
+        subprocess.check_call(
+            [binary_name, "-shape", shape, str(n), output_name])
+        print "generated " + shape + " " + str(n)
@@ -1,9 +1,71 @@
 #include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
 
+#include <iostream>
+#include <string>
+#include <utility>
+
 #include <dynamic_trees/benchmarks/benchmark.hpp>
+#include <psl/numa_placement.hpp>
+#include <utilities/include/parse_command_line.h>
+
+namespace {
+
+using EulerTourTree = parallel_euler_tour_tree::EulerTourTree;
+
+// Whether to turn on the representative cache of the benchmarked forests, and
+// how to place them on NUMA nodes. Set from the command line.
+bool use_representative_cache{false};
+numa_placement::Policy numa_policy{numa_placement::Policy::kFirstTouch};
+
+class CachedEulerTourTree : public EulerTourTree {
+ public:
+  explicit CachedEulerTourTree(int num_vertices)
+      : EulerTourTree{num_vertices, numa_policy} {
+    SetRepresentativeCacheEnabled(use_representative_cache);
+  }
+};
+
+// Euler tour tree whose `BatchCut` is `BatchCutOneRound`, so that
+// `RunBenchmark` can time it.
+class OneRoundCutEulerTourTree : public CachedEulerTourTree {
+ public:
+  using CachedEulerTourTree::CachedEulerTourTree;
+  void BatchCut(std::pair<int, int>* cuts, int len) {
+    BatchCutOneRound(cuts, len);
+  }
+};
+
+}  // namespace
 
+// Pass `-cut one-round` to benchmark `BatchCutOneRound` instead of the default
+// `BatchCut`. Pass `-cache` to turn on the representative cache. Pass `-numa
+// interleaved` or `-numa partitioned` to place the forests on NUMA nodes by
+// that policy; built with `PSL_PERF_COUNTERS`, the phase counts then show how
+// many loads went to another node.
 int main(int argc, char** argv) {
-  dynamic_trees_benchmark::RunBenchmark<
-      parallel_euler_tour_tree::EulerTourTree>(argc, argv);
+  commandLine P{argc, argv,
+      "[-iters] [-cut (deferral|one-round)] [-cache] "
+      "[-numa (first-touch|interleaved|partitioned)] [-workload] "
+      "graph_filename"};
+  const std::string cut_method{P.getOptionValue("-cut", "deferral")};
+  use_representative_cache = P.getOption("-cache");
+  if (!numa_placement::ParsePolicy(
+          P.getOptionValue("-numa", "first-touch"), &numa_policy)) {
+    P.badArgument();
+  }
+  std::cout << "NUMA policy " << numa_placement::PolicyName(numa_policy)
+            << " over " << numa_placement::NumNodes() << " nodes" << std::endl;
+  if (cut_method == "one-round") {
+    dynamic_trees_benchmark::RunBenchmark<OneRoundCutEulerTourTree>(argc, argv);
+  } else if (cut_method == "deferral") {
+    dynamic_trees_benchmark::RunBenchmark<CachedEulerTourTree>(argc, argv);
+  } else {
+    P.badArgument();
+  }
+  if (operation_counters::kEnabled) {
+    std::cout << "skip list operation counts over all runs:\n";
+    operation_counters::ReportOperationCounts(std::cout,
+        parallel_euler_tour_tree::_internal::Element<int32_t>::GetOperationCounts());
+  }
   return 0;
 }
@@ -4,9 +4,16 @@ n=10000000
 threads=(2 4 8 16 32 64 72 144)
 iters=3
 graphs=('binary_tree' 'star' 'path' 'recursive_tree')
+# graphs on which to compare `BatchCutOneRound` against `BatchCut`
+one_round_cut_graphs=('star' 'path')
+# streams of interleaved links, cuts and queries to replay on each graph
+mixed_workloads=('sliding-window' 'edge-flip')
+# sequence structures to run the Euler tour tree over in `sequence_ett`
+sequences=('skip_list' 'augmented_skip_list' 'treap')
 
 sequential_targets=('link_cut_tree' 'skip_list_ett' 'splay_tree_ett')
-bin_dir=$(git rev-parse --show-toplevel)/bin
+# Executables are built by CMake into `build/bin/` (see the top-level README).
+bin_dir=$(git rev-parse --show-toplevel)/build/bin
 graphs_dir='data/graphs'
 output_dir='times'
 
@@ -42,7 +49,6 @@ mkdir $output_dir
 rm -i $output_dir/*
 
 cd parallel_ett
-make -s
 benchmark_bin=${bin_dir}/benchmark_dynamic_trees_parallel_ett
 for g in ${graphs[@]}
 do
@@ -50,15 +56,53 @@ do
   get_output_file 'parallel_ett' $g
   for t in ${threads[@]}
   do
-    CILK_NWORKERS=$t numactl -i all $benchmark_bin -iters $iters $graph_file >> $output_file
+    PARLAY_NUM_THREADS=$t numactl -i all $benchmark_bin -iters $iters $graph_file >> $output_file
   done
 done
 
+for g in ${one_round_cut_graphs[@]}
+do
+  get_graph_file $g
+  get_output_file 'parallel_ett_one_round_cut' $g
+  for t in ${threads[@]}
+  do
+    PARLAY_NUM_THREADS=$t numactl -i all $benchmark_bin -iters $iters -cut one-round $graph_file >> $output_file
+  done
+done
+
+for w in ${mixed_workloads[@]}
+do
+  for g in ${graphs[@]}
+  do
+    get_graph_file $g
+    get_output_file 'parallel_ett_'${w} $g
+    for t in ${threads[@]}
+    do
+      PARLAY_NUM_THREADS=$t numactl -i all $benchmark_bin -workload $w $graph_file >> $output_file
+    done
+  done
+done
+
+benchmark_bin=${bin_dir}/benchmark_dynamic_trees_sequence_ett
+for s in ${sequences[@]}
+do
+  for g in ${graphs[@]}
+  do
+    get_graph_file $g
+    get_output_file 'sequence_ett_'${s} $g
+    for t in ${threads[@]}
+    do
+      PARLAY_NUM_THREADS=$t numactl -i all $benchmark_bin -iters $iters -sequence $s $graph_file >> $output_file
+    done
+  done
+done
+
+benchmark_bin=${bin_dir}/benchmark_dynamic_trees_parallel_ett
 for g in ${graphs[@]}
 do
   get_graph_file $g
   get_output_file 'parallel_ett' $g
-  CILK_NWORKERS=1 $benchmark_bin -iters $iters $graph_file >> $output_file &
+  PARLAY_NUM_THREADS=1 $benchmark_bin -iters $iters $graph_file >> $output_file &
   save_last_process_id
 done
 cd ..
@@ -66,13 +110,18 @@ cd ..
 for target in ${sequential_targets[@]}
 do
   cd $target
-  make -s
   for g in ${graphs[@]}
   do
     get_graph_file $g
     get_output_file $target $g
     ${bin_dir}/benchmark_dynamic_trees_${target} -iters $iters $graph_file >> $output_file &
     save_last_process_id
+    for w in ${mixed_workloads[@]}
+    do
+      get_output_file ${target}'_'${w} $g
+      ${bin_dir}/benchmark_dynamic_trees_${target} -workload $w $graph_file >> $output_file &
+      save_last_process_id
+    done
   done
   cd ..
 done
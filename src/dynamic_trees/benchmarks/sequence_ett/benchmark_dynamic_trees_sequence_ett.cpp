@@ -0,0 +1,28 @@
+#include <dynamic_trees/parallel_euler_tour_tree/include/sequence_euler_tour_tree.hpp>
+
+#include <string>
+
+#include <dynamic_trees/benchmarks/benchmark.hpp>
+#include <utilities/include/parse_command_line.h>
+
+// Pass `-sequence (skip_list|augmented_skip_list|treap)` to choose the sequence
+// structure that the Euler tours are kept in.
+int main(int argc, char** argv) {
+  commandLine P{argc, argv,
+      "[-iters] [-sequence (skip_list|augmented_skip_list|treap)] "
+      "[-workload] graph_filename"};
+  const std::string sequence{P.getOptionValue("-sequence", "skip_list")};
+  if (sequence == "skip_list") {
+    dynamic_trees_benchmark::RunBenchmark<
+        parallel_euler_tour_tree::SkipListEulerTourTree>(argc, argv);
+  } else if (sequence == "augmented_skip_list") {
+    dynamic_trees_benchmark::RunBenchmark<
+        parallel_euler_tour_tree::AugmentedSkipListEulerTourTree>(argc, argv);
+  } else if (sequence == "treap") {
+    dynamic_trees_benchmark::RunBenchmark<
+        parallel_euler_tour_tree::TreapEulerTourTree>(argc, argv);
+  } else {
+    P.badArgument();
+  }
+  return 0;
+}
@@ -1,5 +1,6 @@
 #include <dynamic_trees/euler_tour_tree/include/skip_list_ett.hpp>
 
+#include <psl/utils.h>
 #include <utilities/include/random.h>
 
 namespace skip_list_ett {
@@ -9,7 +10,7 @@ using std::pair;
 
 EulerTourTree::EulerTourTree(int _num_verts) : num_verts(_num_verts) {
   pbbs::random randomness;
-  verts = pbbs::new_array_no_init<Element>(num_verts);
+  verts = new_array_no_init<Element>(num_verts);
   for (int i = 0; i < num_verts; i++) {
     new (&verts[i]) Element(randomness.ith_rand(i));
     Element::Join(&verts[i], &verts[i]);
@@ -30,7 +31,7 @@ EulerTourTree::~EulerTourTree() {
   for (auto it : node_pool) {
     delete it;
   }
-  pbbs::delete_array(verts, num_verts);
+  delete_array(verts, num_verts);
 }
 
 bool EulerTourTree::IsConnected(int u, int v) {
@@ -42,8 +43,8 @@ void EulerTourTree::Link(int u, int v) {
   node_pool.pop_back();
   Element* vu = node_pool.back();
   node_pool.pop_back();
-  edges[make_pair(u, v)] = uv;
-  edges[make_pair(v, u)] = vu;
+  edges[std::make_pair(u, v)] = uv;
+  edges[std::make_pair(v, u)] = vu;
   Element* u_left = &verts[u];
   Element* v_left = &verts[v];
   Element* u_right = u_left->Split();
@@ -74,7 +75,7 @@ void EulerTourTree::Cut(int u, int v) {
 }
 
 bool* EulerTourTree::BatchConnected(pair<int, int>* queries, int len) {
-  bool* ans = pbbs::new_array_no_init<bool>(len);
+  bool* ans = new bool[len];
   for (int i = 0; i < len; i++) {
     ans[i] = IsConnected(queries[i].first, queries[i].second);
   }
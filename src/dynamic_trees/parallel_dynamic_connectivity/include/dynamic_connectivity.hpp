@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
+#include <parlay/sequence.h>
+
+namespace parallel_dynamic_connectivity {
+
+// Batch-dynamic connectivity on a general graph.
+//
+// A spanning forest of the graph is kept in a batch-parallel Euler tour tree,
+// and the other edges are kept in per-vertex adjacency sets. An inserted edge
+// that joins two components becomes a forest edge. When forest edges are
+// deleted, each tree they lay in falls apart into pieces, and the pieces are
+// reconnected with replacement edges found among the other edges. Any such
+// replacement edge has an endpoint outside the largest piece of its tree, so
+// only the other pieces are scanned. Vertices with non-forest edges are marked
+// in the forest, so a scan visits just those vertices of a piece. A batch of
+// deletions thus takes work linear in the number of non-forest edges of the
+// scanned pieces, times O(log n) expected work to find their endpoints (there
+// is no level hierarchy as in Holm et al.'s structure to amortize the scans),
+// and O(k log(1 + n/k)) expected work for the forest updates themselves.
+//
+// Vertex IDs, and the lengths of batches, have type `Vertex`, which is either
+// `int32_t` (`DynamicConnectivity`) or `int64_t` (`DynamicConnectivity64`).
+template <typename Vertex>
+class BasicDynamicConnectivity {
+ public:
+  using Edge = std::pair<Vertex, Vertex>;
+
+  BasicDynamicConnectivity() = delete;
+  // Initializes an n-vertex graph with no edges.
+  explicit BasicDynamicConnectivity(Vertex num_vertices);
+  BasicDynamicConnectivity(const BasicDynamicConnectivity&) = delete;
+  BasicDynamicConnectivity(BasicDynamicConnectivity&&) = delete;
+  BasicDynamicConnectivity& operator=(const BasicDynamicConnectivity&) =
+      delete;
+  BasicDynamicConnectivity& operator=(BasicDynamicConnectivity&&) = delete;
+
+  // Returns true if `u` and `v` are connected in the graph.
+  bool IsConnected(Vertex u, Vertex v) const;
+  // For each pair (u, v) in the `len`-length array `queries`, returns whether u
+  // and v are connected in the graph. The returned array should be freed with
+  // `delete[]`.
+  bool* BatchConnected(Edge* queries, Vertex len) const;
+
+  // Adds all edges in the `len`-length array `edges` to the graph. These edges
+  // must not be in the graph already, must be distinct (also when either of
+  // them is reversed), and must not be self-loops.
+  void BatchInsertEdges(Edge* edges, Vertex len);
+  // Removes all edges in the `len`-length array `edges` from the graph. These
+  // edges must be present in the graph and must be distinct (also when either
+  // of them is reversed).
+  void BatchDeleteEdges(Edge* edges, Vertex len);
+
+  // Returns the number of edges in the spanning forest.
+  size_t NumForestEdges() const { return num_forest_edges_; }
+
+ private:
+  // Links a maximal subset of the `len` edges in `edges` into the forest
+  // without creating a cycle, and writes whether each edge was linked to
+  // `linked[i]`.
+  void LinkSpanningSubset(Edge* edges, size_t len, bool* linked);
+  // Inserts (if `insert` is true) or erases `edges` as non-forest edges, and
+  // marks exactly the updated vertices that are left with non-forest edges.
+  void UpdateNonForestEdges(const parlay::sequence<Edge>& edges, bool insert);
+
+  Vertex num_vertices_;
+  // Spanning forest of the graph. Subtree aggregates are on with every vertex
+  // valued 1, so that the size of a tree can be looked up, and the vertices
+  // with non-forest edges are marked.
+  parallel_euler_tour_tree::BasicEulerTourTree<Vertex> forest_;
+  // For each vertex, its neighbors along forest edges and along the other
+  // edges respectively.
+  std::vector<std::unordered_set<Vertex>> forest_neighbors_;
+  std::vector<std::unordered_set<Vertex>> non_forest_neighbors_;
+  size_t num_forest_edges_{0};
+};
+
+using DynamicConnectivity = BasicDynamicConnectivity<int32_t>;
+using DynamicConnectivity64 = BasicDynamicConnectivity<int64_t>;
+
+}  // namespace parallel_dynamic_connectivity
@@ -0,0 +1,227 @@
+#include <dynamic_trees/parallel_dynamic_connectivity/include/dynamic_connectivity.hpp>
+
+#include <algorithm>
+#include <tuple>
+#include <type_traits>
+
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+
+namespace parallel_dynamic_connectivity {
+
+namespace {
+
+  // Returns the edges both ways round, grouped by their first vertex.
+  template <typename Vertex>
+  parlay::sequence<std::pair<Vertex, Vertex>> BothDirectionsByFirst(
+      const parlay::sequence<std::pair<Vertex, Vertex>>& edges) {
+    parlay::sequence<std::pair<Vertex, Vertex>> directed{parlay::tabulate(
+        2 * edges.size(), [&](size_t i) {
+          const std::pair<Vertex, Vertex>& edge{edges[i / 2]};
+          return i % 2 == 0 ? edge : std::make_pair(edge.second, edge.first);
+        })};
+    parlay::integer_sort_inplace(directed,
+        [](const std::pair<Vertex, Vertex>& edge) {
+          return static_cast<std::make_unsigned_t<Vertex>>(edge.first);
+        });
+    return directed;
+  }
+
+  // Inserts (if `insert` is true) or erases each of `edges` into the adjacency
+  // sets, and returns the vertices whose sets were updated. The sets of distinct
+  // vertices are updated in parallel.
+  template <typename Vertex>
+  parlay::sequence<Vertex> UpdateNeighbors(std::vector<std::unordered_set<Vertex>>* neighbors,
+      const parlay::sequence<std::pair<Vertex, Vertex>>& edges, bool insert) {
+    const parlay::sequence<std::pair<Vertex, Vertex>> directed{
+        BothDirectionsByFirst(edges)};
+    const size_t len{directed.size()};
+    const parlay::sequence<size_t> group_starts{parlay::pack_index(
+        parlay::delayed_seq<bool>(len, [&](size_t i) {
+          return i == 0 || directed[i].first != directed[i - 1].first;
+        }))};
+    parlay::parallel_for(0, group_starts.size(), [&](size_t i) {
+      const size_t group_end{
+          i + 1 == group_starts.size() ? len : group_starts[i + 1]};
+      std::unordered_set<Vertex>& vertex_neighbors{
+          (*neighbors)[directed[group_starts[i]].first]};
+      for (size_t j = group_starts[i]; j < group_end; j++) {
+        if (insert) {
+          vertex_neighbors.insert(directed[j].second);
+        } else {
+          vertex_neighbors.erase(directed[j].second);
+        }
+      }
+    });
+    return parlay::map(group_starts, [&](size_t i) {
+      return directed[i].first;
+    });
+  }
+
+}  // namespace
+
+template <typename Vertex>
+BasicDynamicConnectivity<Vertex>::BasicDynamicConnectivity(Vertex num_vertices)
+    : num_vertices_{num_vertices}
+    , forest_{num_vertices}
+    , forest_neighbors_(num_vertices)
+    , non_forest_neighbors_(num_vertices) {
+  forest_.SetSubtreeAggregatesEnabled(true);
+}
+
+template <typename Vertex>
+bool BasicDynamicConnectivity<Vertex>::IsConnected(Vertex u, Vertex v) const {
+  return forest_.IsConnected(u, v);
+}
+
+template <typename Vertex>
+bool* BasicDynamicConnectivity<Vertex>::BatchConnected(
+    Edge* queries, Vertex len) const {
+  return forest_.BatchConnected(queries, len);
+}
+
+template <typename Vertex>
+void BasicDynamicConnectivity<Vertex>::LinkSpanningSubset(
+    Edge* edges, size_t len, bool* linked) {
+  forest_.BatchInsertEdgesFiltered(edges, len, linked);
+  parlay::sequence<Edge> links{parlay::pack(
+      parlay::make_slice(edges, edges + len),
+      parlay::make_slice(linked, linked + len))};
+  UpdateNeighbors(&forest_neighbors_, links, true);
+  num_forest_edges_ += links.size();
+}
+
+template <typename Vertex>
+void BasicDynamicConnectivity<Vertex>::UpdateNonForestEdges(
+    const parlay::sequence<Edge>& edges, bool insert) {
+  const parlay::sequence<Vertex> vertices{
+      UpdateNeighbors(&non_forest_neighbors_, edges, insert)};
+  const parlay::sequence<bool> marks{parlay::map(vertices, [&](Vertex v) {
+    return !non_forest_neighbors_[v].empty();
+  })};
+  forest_.BatchSetMark(vertices.data(), marks.data(), vertices.size());
+}
+
+template <typename Vertex>
+void BasicDynamicConnectivity<Vertex>::BatchInsertEdges(
+    Edge* edges, Vertex len) {
+  parlay::sequence<bool> linked(len);
+  LinkSpanningSubset(edges, len, linked.data());
+  UpdateNonForestEdges(parlay::pack(
+      parlay::make_slice(edges, edges + len),
+      parlay::delayed_seq<bool>(len, [&](size_t i) { return !linked[i]; })),
+      true);
+}
+
+template <typename Vertex>
+void BasicDynamicConnectivity<Vertex>::BatchDeleteEdges(
+    Edge* edges, Vertex len) {
+  const parlay::sequence<bool> is_forest_edge{parlay::tabulate(len,
+      [&](size_t i) {
+        return forest_neighbors_[edges[i].first].count(edges[i].second) > 0;
+      })};
+  UpdateNonForestEdges(parlay::pack(
+      parlay::make_slice(edges, edges + len),
+      parlay::delayed_seq<bool>(len, [&](size_t i) {
+        return !is_forest_edge[i];
+      })), false);
+  parlay::sequence<Edge> cuts{parlay::pack(
+      parlay::make_slice(edges, edges + len), is_forest_edge)};
+  const size_t num_cuts{cuts.size()};
+  if (num_cuts == 0) {
+    return;
+  }
+
+  // Each endpoint of a cut lies in a piece of the tree that the cut was in, and
+  // every piece has such an endpoint.
+  const parlay::sequence<Vertex> endpoints{parlay::tabulate(2 * num_cuts,
+      [&](size_t i) {
+        return i % 2 == 0 ? cuts[i / 2].first : cuts[i / 2].second;
+      })};
+  parlay::sequence<uintptr_t> tree_ids(2 * num_cuts);
+  forest_.BatchGetComponentIds(
+      endpoints.data(), 2 * num_cuts, tree_ids.data());
+  forest_.BatchCut(cuts.data(), num_cuts);
+  UpdateNeighbors(&forest_neighbors_, cuts, false);
+  num_forest_edges_ -= num_cuts;
+  parlay::sequence<uintptr_t> piece_ids(2 * num_cuts);
+  forest_.BatchGetComponentIds(
+      endpoints.data(), 2 * num_cuts, piece_ids.data());
+
+  // Sort the endpoints by tree and then by piece, and keep one endpoint per
+  // piece.
+  parlay::sequence<std::tuple<uintptr_t, uintptr_t, Vertex>> endpoint_pieces{
+      parlay::tabulate(2 * num_cuts, [&](size_t i) {
+        return std::make_tuple(tree_ids[i], piece_ids[i], endpoints[i]);
+      })};
+  parlay::sort_inplace(endpoint_pieces);
+  const parlay::sequence<std::tuple<uintptr_t, uintptr_t, Vertex>> pieces{
+      parlay::pack(endpoint_pieces,
+          parlay::delayed_seq<bool>(2 * num_cuts, [&](size_t i) {
+            return i == 0 || std::get<1>(endpoint_pieces[i]) !=
+                std::get<1>(endpoint_pieces[i - 1]);
+          }))};
+  const size_t num_pieces{pieces.size()};
+  const parlay::sequence<int64_t> piece_sizes{parlay::tabulate(num_pieces,
+      [&](size_t i) {
+        const Vertex v{std::get<2>(pieces[i])};
+        return forest_.SubtreeAggregate(v, v);
+      })};
+
+  // Scan every piece but the largest one of each tree.
+  const parlay::sequence<size_t> tree_starts{parlay::pack_index(
+      parlay::delayed_seq<bool>(num_pieces, [&](size_t i) {
+        return i == 0 ||
+            std::get<0>(pieces[i]) != std::get<0>(pieces[i - 1]);
+      }))};
+  parlay::sequence<bool> is_scanned(num_pieces, true);
+  parlay::parallel_for(0, tree_starts.size(), [&](size_t i) {
+    const size_t tree_end{
+        i + 1 == tree_starts.size() ? num_pieces : tree_starts[i + 1]};
+    size_t largest{tree_starts[i]};
+    for (size_t j = tree_starts[i] + 1; j < tree_end; j++) {
+      if (piece_sizes[j] > piece_sizes[largest]) {
+        largest = j;
+      }
+    }
+    is_scanned[largest] = false;
+  });
+  const parlay::sequence<Vertex> scanned_pieces{parlay::map(
+      parlay::pack(pieces, is_scanned),
+      [](const std::tuple<uintptr_t, uintptr_t, Vertex>& piece) {
+        return std::get<2>(piece);
+      })};
+  // Only the marked vertices of a piece have non-forest edges.
+  parlay::sequence<parlay::sequence<Vertex>> piece_vertices(
+      scanned_pieces.size());
+  parlay::parallel_for(0, scanned_pieces.size(), [&](size_t i) {
+    forest_.FindMarked(scanned_pieces[i], num_vertices_, &piece_vertices[i]);
+  });
+
+  // Gather the non-forest edges leaving the scanned pieces, each once, and
+  // link as many of them as can be linked.
+  parlay::sequence<Edge> candidates{parlay::flatten(parlay::map(
+      parlay::flatten(piece_vertices), [&](Vertex v) {
+        std::vector<Edge> incident;
+        incident.reserve(non_forest_neighbors_[v].size());
+        for (Vertex w : non_forest_neighbors_[v]) {
+          incident.push_back(std::minmax(v, w));
+        }
+        return incident;
+      }))};
+  parlay::sort_inplace(candidates);
+  parlay::sequence<Edge> distinct_candidates{parlay::pack(candidates,
+      parlay::delayed_seq<bool>(candidates.size(), [&](size_t i) {
+        return i == 0 || candidates[i] != candidates[i - 1];
+      }))};
+  parlay::sequence<bool> linked(distinct_candidates.size());
+  LinkSpanningSubset(
+      distinct_candidates.data(), distinct_candidates.size(), linked.data());
+  UpdateNonForestEdges(parlay::pack(distinct_candidates, linked), false);
+}
+
+template class BasicDynamicConnectivity<int32_t>;
+template class BasicDynamicConnectivity<int64_t>;
+
+}  // namespace parallel_dynamic_connectivity
@@ -0,0 +1,129 @@
+#include <dynamic_trees/parallel_dynamic_connectivity/include/dynamic_connectivity.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+using DynamicConnectivity =
+    parallel_dynamic_connectivity::DynamicConnectivity;
+
+constexpr int num_vertices{300};
+constexpr int insertions_per_round{250};
+constexpr int delete_ratio{3};
+constexpr int num_rounds{12};
+
+// Labels each vertex with the smallest vertex in its component of the graph
+// with edge set `edges`.
+std::vector<int> ReferenceComponents(const std::set<std::pair<int, int>>& edges) {
+  std::vector<int> parents(num_vertices);
+  std::iota(parents.begin(), parents.end(), 0);
+  const auto find{[&](int v) {
+    while (parents[v] != v) {
+      v = parents[v] = parents[parents[v]];
+    }
+    return v;
+  }};
+  for (const std::pair<int, int>& edge : edges) {
+    const int u{find(edge.first)}, v{find(edge.second)};
+    parents[std::max(u, v)] = std::min(u, v);
+  }
+  std::vector<int> components(num_vertices);
+  for (int v = 0; v < num_vertices; v++) {
+    components[v] = find(v);
+  }
+  return components;
+}
+
+// Checks connectivity between all pairs of vertices, and that the spanning
+// forest has one edge fewer than each component has vertices.
+void CheckConnectivity(const std::set<std::pair<int, int>>& edges,
+    const DynamicConnectivity& graph) {
+  const std::vector<int> components{ReferenceComponents(edges)};
+  std::vector<std::pair<int, int>> queries;
+  for (int u = 0; u < num_vertices; u++) {
+    for (int v = u; v < num_vertices; v++) {
+      queries.emplace_back(u, v);
+    }
+  }
+  bool* connected{graph.BatchConnected(queries.data(), queries.size())};
+  for (size_t i = 0; i < queries.size(); i++) {
+    const int u{queries[i].first}, v{queries[i].second};
+    assert(connected[i] == (components[u] == components[v]));
+    assert(graph.IsConnected(u, v) == connected[i]);
+  }
+  delete[] connected;
+  size_t num_components{0};
+  for (int v = 0; v < num_vertices; v++) {
+    num_components += components[v] == v;
+  }
+  assert(graph.NumForestEdges() == num_vertices - num_components);
+}
+
+// Inserts random edges into a graph and deletes random subsets of its edges in
+// batches, in either orientation, checking connectivity after each batch. Then
+// deletes the edges of a cycle one batch at a time so that each deletion needs
+// a replacement edge until the last two.
+int main() {
+  std::mt19937 rng{};
+  rng.seed(0);
+  std::uniform_int_distribution<int> vert_dist{0, num_vertices - 1};
+  std::uniform_int_distribution<int> coin{0, 1};
+
+  DynamicConnectivity graph{num_vertices};
+  std::set<std::pair<int, int>> edges;
+  for (int round = 0; round < num_rounds; round++) {
+    std::vector<std::pair<int, int>> insertions;
+    for (int i = 0; i < insertions_per_round; i++) {
+      const int u{vert_dist(rng)}, v{vert_dist(rng)};
+      if (u != v && edges.emplace(std::min(u, v), std::max(u, v)).second) {
+        insertions.emplace_back(u, v);
+      }
+    }
+    graph.BatchInsertEdges(insertions.data(), insertions.size());
+    CheckConnectivity(edges, graph);
+
+    std::vector<std::pair<int, int>> deletions;
+    int count{0};
+    for (const std::pair<int, int>& edge : edges) {
+      if (++count % delete_ratio == 0) {
+        deletions.push_back(edge);
+      }
+    }
+    for (std::pair<int, int>& edge : deletions) {
+      edges.erase(edge);
+      if (coin(rng) == 1) {
+        std::swap(edge.first, edge.second);
+      }
+    }
+    graph.BatchDeleteEdges(deletions.data(), deletions.size());
+    CheckConnectivity(edges, graph);
+  }
+
+  std::vector<std::pair<int, int>> all_edges(edges.begin(), edges.end());
+  graph.BatchDeleteEdges(all_edges.data(), all_edges.size());
+  edges.clear();
+  CheckConnectivity(edges, graph);
+  std::vector<std::pair<int, int>> cycle;
+  for (int v = 0; v < num_vertices; v++) {
+    cycle.emplace_back(v, (v + 1) % num_vertices);
+    edges.emplace(std::min(v, (v + 1) % num_vertices),
+        std::max(v, (v + 1) % num_vertices));
+  }
+  graph.BatchInsertEdges(cycle.data(), cycle.size());
+  CheckConnectivity(edges, graph);
+  for (int i = 0; i < num_vertices; i += 50) {
+    graph.BatchDeleteEdges(&cycle[i], 50);
+    for (int j = i; j < i + 50; j++) {
+      edges.erase(std::make_pair(std::min(cycle[j].first, cycle[j].second),
+          std::max(cycle[j].first, cycle[j].second)));
+    }
+    CheckConnectivity(edges, graph);
+  }
+
+  std::cout << "Test complete." << std::endl;
+}
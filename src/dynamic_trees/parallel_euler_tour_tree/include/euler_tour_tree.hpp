@@ -1,54 +1,379 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <type_traits>
 #include <utility>
+#include <vector>
 
+#include <dynamic_trees/parallel_euler_tour_tree/src/chunked_array.hpp>
 #include <dynamic_trees/parallel_euler_tour_tree/src/edge_map.hpp>
 #include <dynamic_trees/parallel_euler_tour_tree/src/euler_tour_sequence.hpp>
-#include <utilities/include/random.h>
+#include <parlay/random.h>
+#include <parlay/sequence.h>
+#include <psl/concurrent_array_allocator.hpp>
+#include <psl/numa_placement.hpp>
+#include <psl/perf_counters.hpp>
 
 namespace parallel_euler_tour_tree {
 
-// Euler tour trees represent forests. We may add an edge using `Link`, remove
-// an edge using `Cut`, and query whether two vertices are in the same tree
-// using `IsConnected`. This implementation can also exploit parallelism when
-// many edges are added at once through `BatchLink` or many edges are deleted at
-// once through `BatchCut`.
-class EulerTourTree {
+namespace _internal {
+
+template <typename Forest, typename Sequence>
+class BatchTourUpdates;
+
+}  // namespace _internal
+
+// File signatures of the format written by `BasicEulerTourTree::Save`, for
+// forests with 32-bit and with 64-bit vertex IDs respectively.
+constexpr char kForestFileMagic[8]{'E', 'T', 'T', 'F', 'R', 'S', 'T', '1'};
+constexpr char kForestFileMagic64[8]{'E', 'T', 'T', 'F', 'R', 'S', '6', '4'};
+
+// Vertex IDs, and the lengths of batches, have type `Vertex`, which is either
+// `int32_t` (`EulerTourTree`) or `int64_t` (`EulerTourTree64`, for forests
+// with 2^31 or more vertices). The 64-bit version takes more memory per edge.
+//
+// When built with `PSL_PERF_COUNTERS`, the batch operations record hardware
+// counters for each of their phases (see `psl/perf_counters.hpp`).
+template <typename Vertex>
+class BasicEulerTourTree {
+  static_assert(std::is_same<Vertex, int32_t>::value ||
+      std::is_same<Vertex, int64_t>::value,
+      "Vertex IDs must be int32_t or int64_t");
+
  public:
-  EulerTourTree() = delete;
-  // Initializes n-vertex forest with no edges.
-  explicit EulerTourTree(int num_vertices);
-  ~EulerTourTree();
-  EulerTourTree(const EulerTourTree&) = delete;
-  EulerTourTree(EulerTourTree&&) = delete;
-  EulerTourTree& operator=(const EulerTourTree&) = delete;
-  EulerTourTree& operator=(EulerTourTree&&) = delete;
+  using Edge = std::pair<Vertex, Vertex>;
+
+  BasicEulerTourTree() = delete;
+  // Initializes n-vertex forest with no edges. Each forest allocates its
+  // elements from allocators of its own, so forests share no state and may be
+  // created and destroyed in any order.
+  explicit BasicEulerTourTree(Vertex num_vertices);
+  // Same, but places the forest's memory on NUMA nodes by `numa_policy` (see
+  // "psl/numa_placement.hpp"):
+  // - `kFirstTouch` leaves memory on the node of the worker that first touches
+  //   it, as the constructor above does.
+  // - `kInterleaved` spreads the vertex elements, the edge table, and the
+  //   allocators' blocks over all nodes.
+  // - `kPartitioned` splits the vertex IDs into one contiguous range per node.
+  //   Vertex v's element, the elements of edges (v, w), and their skip list
+  //   neighbor arrays go on the node of v's range. The edge table, which is
+  //   hashed, is interleaved. Vertices added later continue the ranges
+  //   round-robin.
+  // Subtree aggregates, if turned on, are kept outside of these placements.
+  BasicEulerTourTree(Vertex num_vertices, numa_placement::Policy numa_policy);
+  // Releases the forest's elements by dropping its allocators rather than
+  // freeing the elements one by one, unless subtree aggregates are on.
+  ~BasicEulerTourTree();
+  BasicEulerTourTree(const BasicEulerTourTree&) = delete;
+  BasicEulerTourTree(BasicEulerTourTree&&) = delete;
+  BasicEulerTourTree& operator=(const BasicEulerTourTree&) = delete;
+  BasicEulerTourTree& operator=(BasicEulerTourTree&&) = delete;
 
   // Returns true if `u` and `v` are in the same tree in the represented forest.
-  bool IsConnected(int u, int v) const;
+  bool IsConnected(Vertex u, Vertex v) const;
   // Adds edge {`u`, `v`} to forest. The addition of this edge must not create a
   // cycle in the graph.
-  void Link(int u, int v);
+  void Link(Vertex u, Vertex v);
   // Removes edge {`u`, `v`} from forest. The edge must be present in the
   // forest.
-  void Cut(int u, int v);
+  void Cut(Vertex u, Vertex v);
 
+  // For each pair (u, v) in the `len`-length array `queries`, returns whether u
+  // and v are connected in the forest. The returned array should be freed with
+  // `delete[]`.
+  bool* BatchConnected(Edge* queries, Vertex len) const;
+  // Writes the vertices of the tree containing `v` to `out` in the order that
+  // the tree's Euler tour visits them. The tour is flattened in parallel,
+  // taking O(s) expected work and O(log^2 s) depth for a tree on s vertices.
+  void GetComponentVertices(Vertex v, parlay::sequence<Vertex>* out) const;
+  // For each vertex in the `len`-length array `vertices`, writes the vertices
+  // of its tree to `(*out)[i]` as `GetComponentVertices` would. The distinct
+  // trees are walked in parallel, and each only once even if several of the
+  // queried vertices lie in it.
+  void BatchGetComponentVertices(const Vertex* vertices, Vertex len,
+      parlay::sequence<parlay::sequence<Vertex>>* out) const;
+  // For each vertex in the `len`-length array `vertices`, writes an identifier
+  // of its tree to `ids[i]`, so that two vertices get the same identifier if
+  // and only if they are connected. The identifiers are only valid until the
+  // next update to the forest.
+  void BatchGetComponentIds(
+      const Vertex* vertices, Vertex len, uintptr_t* ids) const;
   // Adds all edges in the `len`-length array `links` to the forest. Adding
   // these edges must not create cycles in the graph.
-  void BatchLink(std::pair<int, int>* links, int len);
+  void BatchLink(Edge* links, Vertex len);
+  // Links a maximal subset of the edges in the `len`-length array `edges` that
+  // keeps the forest acyclic, accounting for cycles among the edges themselves
+  // as well as with the forest, and writes whether each edge was linked to
+  // `accepted_out[i]`. Self-loops, edges between connected vertices, and
+  // repeats of an edge are rejected. Which edges of a cycle within the batch
+  // are accepted is unspecified. The edges are filtered with a union-find over
+  // the representatives of their endpoints' tours before `BatchLink`ing the
+  // accepted ones.
+  void BatchInsertEdgesFiltered(Edge* edges, Vertex len, bool* accepted_out);
   // Removes all edges in the `len`-length array `cuts` from the forest. These
   // edges must be present in the forest and must be distinct.
-  void BatchCut(std::pair<int, int>* cuts, int len);
+  void BatchCut(Edge* cuts, Vertex len);
+  // Same as `BatchCut`, but finds where to rejoin the tours in a single round
+  // by contracting chains of adjacent cut edges instead of deferring a random
+  // subset of the cuts to later rounds. This helps when many adjacent tour
+  // edges are cut at once, e.g., when cutting all edges of a star.
+  void BatchCutOneRound(Edge* cuts, Vertex len);
+  // Lenient form of `BatchCut`: removes from the forest every edge in the
+  // `len`-length array `cuts` that is present in the forest, in either
+  // orientation, and writes whether each cut was applied to `applied_out[i]`.
+  // Of the repeats of an edge, in either orientation, only the first is
+  // applied, and cuts of absent edges and self-loops are skipped. The repeats
+  // are found in parallel by grouping the cuts by edge with a hash-based
+  // semisort, which takes O(k) expected work, before `BatchCut`ting the
+  // applied ones.
+  void BatchCutFiltered(Edge* cuts, Vertex len, bool* applied_out);
+
+  // Adds `k` vertices with no edges to the forest and writes their IDs to the
+  // `k`-length array `ids`. IDs freed by `RemoveIsolatedVertices` are reused
+  // first, and the rest are the smallest IDs never handed out. Existing
+  // vertices are not moved. Takes amortized O(k) work, plus the cost of
+  // publishing a snapshot if snapshots are on.
+  void AddVertices(Vertex k, Vertex* ids);
+  // Frees the IDs of the `len` distinct vertices in `ids` for reuse by
+  // `AddVertices`. These vertices must have no edges, and they must not be used
+  // again until their IDs are handed out again.
+  void RemoveIsolatedVertices(const Vertex* ids, Vertex len);
+  // Returns one more than the largest vertex ID handed out so far.
+  Vertex NumVertexIds() const { return num_vertices_; }
+
+  // Turns the representative cache on or off. It is off initially. While it is
+  // on, connectivity queries remember the representative of the tour of each
+  // vertex they look at until the next update to the forest, so that repeated
+  // queries on the same vertices between updates are cheap. The cache takes 16
+  // bytes per vertex.
+  void SetRepresentativeCacheEnabled(bool enabled);
+  // If the representative cache is on, fills it in for all vertices in
+  // parallel.
+  void WarmCache() const;
+
+  // Turns subtree aggregates on or off. They are off initially. While they are
+  // on, each vertex holds an integer value, which starts at 1, and the tours
+  // keep sums of these values that updates maintain at O(log n) expected extra
+  // cost per changed tour element. The sums take 16 bytes per level of each
+  // tour element, or about 32 bytes per element, and a pointer to them makes each
+  // element 8 bytes larger even while they are off. Turning them on takes O(n)
+  // work.
+  void SetSubtreeAggregatesEnabled(bool enabled);
+  // Sets the value of each vertex `vertices[i]` to `values[i]` for the
+  // `len` distinct vertices in `vertices`. Subtree aggregates must be on.
+  void BatchSetVertexValues(
+      const Vertex* vertices, const int64_t* values, Vertex len);
+  // Returns the sum of the values in the subtree of `v` when its tree is rooted
+  // so that `parent` is the parent of `v`, where {`v`, `parent`} must be an
+  // edge of the forest. If `parent` equals `v`, returns the sum over the whole
+  // tree of `v`. Subtree aggregates must be on.
+  //
+  // The subtree of `v` is the part of the tour between (`parent`, `v`) and
+  // (`v`, `parent`), which is the same wherever the cyclic tour is cut open, so
+  // no rerooting is needed. This takes O(log n) expected work.
+  int64_t SubtreeAggregate(Vertex v, Vertex parent) const;
+  // For each pair (v, parent) in the `len`-length array `queries`, returns
+  // `SubtreeAggregate(v, parent)`. The returned array should be freed with
+  // `delete[]`.
+  int64_t* BatchSubtreeAggregate(Edge* queries, Vertex len) const;
+  // Sets whether each vertex `vertices[i]` is marked to `marks[i]` for the
+  // `len` distinct vertices in `vertices`. Vertices start out unmarked, and the
+  // tours keep counts of marked vertices alongside the sums of values. Subtree
+  // aggregates must be on.
+  void BatchSetMark(const Vertex* vertices, const bool* marks, Vertex len);
+  // Writes up to `limit` marked vertices of the tree of `v` to `out`, in the
+  // order that the tree's Euler tour visits them. Only the parts of the tour
+  // with marked vertices are walked, so finding k vertices takes O(k log n)
+  // expected work. Subtree aggregates must be on.
+  void FindMarked(Vertex v, Vertex limit, parlay::sequence<Vertex>* out) const;
+
+  // Writes the forest to `filename` in the following format, streaming the
+  // tours into the file in parallel:
+  //   8 bytes: `kForestFileMagic`, or `kForestFileMagic64` for 64-bit IDs
+  //   8 bytes: number of vertices n as a little-endian uint64
+  //   8 bytes: number of tours t with at least one edge, as a uint64
+  //   8 bytes: total length l of these tours as a uint64
+  //   8(t + 1) bytes: tour offsets as uint64s; tour i is entries
+  //     [offsets[i], offsets[i + 1]) of the tour entries
+  //   `sizeof(Vertex)` * l bytes: tour entries as `Vertex`s
+  // A tour visiting elements (x_1, y_1), (x_2, y_2), ..., (x_k, y_k), where
+  // each (x, x) is a vertex and each (x, y) with x != y is a directed edge, is
+  // stored as y_1, y_2, ..., y_k. Since x_{i+1} = y_i and x_1 = y_k, this
+  // determines the tour. Vertices with no edges are not stored.
+  void Save(const std::string& filename);
+  // Reads a forest written by `Save` into this forest, which must have no edges
+  // and as many vertices as the saved forest. Rather than replaying links, this
+  // builds the tours directly with O(n) expected work. Exits with an error if
+  // the file is not a forest file, or if it lists a vertex or directed edge
+  // more than once or an edge (x, y) without (y, x).
+  void Load(const std::string& filename);
+
+  // At most this many `SnapshotReader`s may exist for a forest at once.
+  static constexpr int kMaxSnapshotReaders{128};
+
+  // Turns connectivity snapshots on or off. They are off initially. While they
+  // are on, each update ends by publishing a snapshot of the connectivity of
+  // the updated forest for `SnapshotReader`s. The snapshot copies the entries
+  // of the trees that the update left alone from the previous snapshot and only
+  // recomputes the trees containing an endpoint of a linked or cut edge, which
+  // costs O(n + k log n + s) expected work and O(log^2 n) depth for an update
+  // of k edges whose trees have s vertices in total. Snapshots must not be
+  // turned off while `SnapshotReader`s exist.
+  void SetSnapshotsEnabled(bool enabled);
+
+  // Answers connectivity queries against the latest snapshot published by a
+  // forest. Unlike `IsConnected`, this may run concurrently with updates to the
+  // forest, in which case it sees the forest from before or after the update
+  // but never in between.
+  //
+  // A reader must only be used by one thread at a time. Snapshots must be
+  // turned on while it exists.
+  class SnapshotReader {
+   public:
+    explicit SnapshotReader(const BasicEulerTourTree* forest);
+    ~SnapshotReader();
+    SnapshotReader(const SnapshotReader&) = delete;
+    SnapshotReader& operator=(const SnapshotReader&) = delete;
+
+    bool IsConnected(Vertex u, Vertex v);
+    // Answers all `len` queries against the same snapshot. The returned array
+    // should be freed with `delete[]`.
+    bool* BatchConnected(Edge* queries, Vertex len);
+
+   private:
+    // Returns the latest snapshot and protects it from being freed until
+    // `Release()`.
+    const uintptr_t* Acquire();
+    void Release();
+
+    const BasicEulerTourTree* forest_;
+    int slot_;
+  };
 
  private:
-  void BatchCutRecurse(std::pair<int, int>* cuts, int len,
-      bool* ignored, _internal::Element** join_targets,
-      _internal::Element** edge_elements);
-
-  int num_vertices_;
-  _internal::Element* vertices_;
-  _internal::EdgeMap edges_;
-  pbbs::random randomness_;
+  using Element = _internal::Element<Vertex>;
+
+  // A reader's slot. `snapshot` holds the snapshot the reader is querying, if
+  // any, which keeps the forest from freeing it (in the manner of a hazard
+  // pointer).
+  struct alignas(64) ReaderSlot {
+    std::atomic<bool> in_use;
+    std::atomic<const uintptr_t*> snapshot;
+  };
+
+  // Bumps `epoch_` and, when the outermost update in scope finishes, publishes
+  // a snapshot.
+  class UpdateScope {
+   public:
+    explicit UpdateScope(BasicEulerTourTree* forest);
+    ~UpdateScope();
+
+   private:
+    BasicEulerTourTree* forest_;
+  };
+
+  // Returns the index of the node that vertex `v` belongs to under the NUMA
+  // policy, which is always 0 unless the policy is `kPartitioned`.
+  int NodeOf(Vertex v) const;
+  // Places the entries of `vertices_` with indices in [`begin`, `end`) on NUMA
+  // nodes by the forest's policy.
+  void PlaceVertices(size_t begin, size_t end);
+
+  // Allocates and constructs the element of an edge (`tail`, w) with the skip
+  // list height seeded by `random_int`, with sums enabled if subtree
+  // aggregates are on.
+  Element* NewEdgeElement(size_t random_int, Vertex tail);
+  // Destroys and frees an edge element from `NewEdgeElement`.
+  void DeleteEdgeElement(Element* element);
+
+  // If snapshots are on, records that the current update links or cuts the
+  // `len` edges in `edges`, so that the next snapshot recomputes their trees.
+  void TouchForSnapshot(const Edge* edges, Vertex len);
+  // If snapshots are on, publishes a snapshot of the current forest and frees
+  // old snapshots that no reader holds anymore.
+  void PublishSnapshot();
+
+  // Returns y for the element (x, y). While saving, edge elements must hold
+  // their y in `ruler_index_`.
+  Vertex ElementTarget(const Element* element) const;
+
+  // A cached representative of a vertex's tour, valid while `epoch` equals the
+  // forest's `epoch_`.
+  struct CachedRepresentative {
+    std::atomic<uint64_t> epoch;
+    std::atomic<Element*> representative;
+  };
+
+  // Returns the representative of the tour containing vertex `v`, going through
+  // the representative cache if it is on.
+  Element* FindRepresentative(Vertex v) const;
+
+  // If subtree aggregates are on, updates the sums over the `len`-length array
+  // `elements` as `Element::BatchUpdateSums` does.
+  void UpdateSums(Element* const* elements, size_t len);
+
+  // Hooks for `BatchTourUpdates`, which does the work of `BatchLink` and
+  // `BatchCut`. See batch_tour_updates.hpp.
+  template <typename Forest, typename Sequence>
+  friend class _internal::BatchTourUpdates;
+  Element* VertexElement(Vertex v) { return &vertices_[v]; }
+  // If subtree aggregates are on, updates the sums after the `len` pairs in
+  // `joins` were joined, recording this in `phases` as the "update sums" phase.
+  void AfterJoins(const std::pair<Element*, Element*>* joins, size_t len,
+      perf_counters::PhaseCounter* phases);
+
+  void BatchCutRecurse(Edge* cuts, Vertex len, bool* ignored,
+      Element** join_targets, Element** edge_elements);
+  void FindJoinTargetsOneRound(Vertex len, Element** join_targets,
+      Element** edge_elements);
+
+  Vertex num_vertices_;
+  numa_placement::Policy numa_policy_;
+  // Under `kPartitioned`, vertex v belongs to node (v / `vertices_per_node_`)
+  // modulo the number of nodes.
+  Vertex vertices_per_node_;
+  // The skip list neighbor arrays and the edge elements of this forest come
+  // from these, indexed by `NodeOf`. They are declared before the elements so
+  // that they outlive them.
+  std::vector<std::unique_ptr<typename Element::NeighborAllocator>>
+      neighbor_allocators_;
+  std::vector<std::unique_ptr<concurrent_array_allocator::Pool>>
+      edge_allocators_;
+  _internal::ChunkedArray<Element> vertices_;
+  // IDs freed by `RemoveIsolatedVertices`.
+  std::vector<Vertex> free_vertex_ids_;
+  _internal::EdgeMap<Vertex> edges_;
+  parlay::random randomness_;
+  // Incremented by every update so that cached representatives from before the
+  // update are invalid.
+  uint64_t epoch_{1};
+  // Holds an entry for each vertex, or is null if the cache is off.
+  _internal::ChunkedArray<CachedRepresentative>* representative_cache_{
+      nullptr};
+  bool has_subtree_aggregates_{false};
+  // Number of `UpdateScope`s in progress.
+  int update_depth_{0};
+  // The latest snapshot, or null if snapshots are off. A snapshot is a
+  // `num_vertices_`-length array mapping each vertex to an identifier of its
+  // tree (the address of its tour's representative, never dereferenced).
+  std::atomic<const uintptr_t*> snapshot_{nullptr};
+  // Number of vertices when the latest snapshot was published.
+  Vertex snapshot_num_vertices_{0};
+  // Endpoints of the edges that the updates in scope linked or cut.
+  std::vector<parlay::sequence<Vertex>> snapshot_touched_vertices_;
+  // Whether the next snapshot must be computed for all vertices rather than
+  // just the trees of `snapshot_touched_vertices_`.
+  bool rebuild_snapshot_{false};
+  // Replaced snapshots that were still held by a reader when last checked.
+  std::vector<const uintptr_t*> retired_snapshots_;
+  // `kMaxSnapshotReaders`-length array, or null if snapshots are off.
+  mutable ReaderSlot* reader_slots_{nullptr};
 };
 
+using EulerTourTree = BasicEulerTourTree<int32_t>;
+using EulerTourTree64 = BasicEulerTourTree<int64_t>;
+
 }  // namespace parallel_euler_tour_tree
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <utility>
+
+#include <dynamic_trees/parallel_euler_tour_tree/include/sequence_policies.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/src/batch_tour_updates.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/src/edge_map.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/src/tour_element.hpp>
+#include <parlay/random.h>
+#include <psl/concurrent_array_allocator.hpp>
+#include <psl/perf_counters.hpp>
+
+namespace parallel_euler_tour_tree {
+
+// Batch-parallel Euler tour tree whose tours are kept in the sequence structure
+// chosen by `Sequence`, one of the policies in sequence_policies.hpp:
+// - `SkipListSequence` (`SkipListEulerTourTree`): the phase-concurrent skip
+//   list that `EulerTourTree` also uses.
+// - `AugmentedSkipListSequence` (`AugmentedSkipListEulerTourTree`): the
+//   augmented skip list, which keeps sequence sizes at the cost of more memory
+//   per element and a pass over the changed places after each batch.
+// - `TreapSequence` (`TreapEulerTourTree`): the parallel treap, which takes the
+//   least memory per element but steps along tours in O(log n) time.
+// Links and cuts run the same batch algorithms as `EulerTourTree`'s (see
+// batch_tour_updates.hpp), which are expressed as batch splits and batch joins
+// on the sequences.
+//
+// This only offers connectivity. The other features of `EulerTourTree`
+// (subtree aggregates, marks, component listing, representative caching,
+// snapshots, and saving and loading) reach into the skip list and are only
+// available there.
+template <typename Sequence>
+class SequenceEulerTourTree {
+ public:
+  using Vertex = int32_t;
+  using Edge = std::pair<Vertex, Vertex>;
+
+  SequenceEulerTourTree() = delete;
+  // Initializes n-vertex forest with no edges. Each forest allocates its
+  // elements from allocators of its own, so forests share no state and may be
+  // created and destroyed in any order.
+  explicit SequenceEulerTourTree(Vertex num_vertices);
+  ~SequenceEulerTourTree();
+  SequenceEulerTourTree(const SequenceEulerTourTree&) = delete;
+  SequenceEulerTourTree(SequenceEulerTourTree&&) = delete;
+  SequenceEulerTourTree& operator=(const SequenceEulerTourTree&) = delete;
+  SequenceEulerTourTree& operator=(SequenceEulerTourTree&&) = delete;
+
+  // Returns true if `u` and `v` are in the same tree in the represented forest.
+  bool IsConnected(Vertex u, Vertex v) const;
+  // Adds edge {`u`, `v`} to forest. The addition of this edge must not create a
+  // cycle in the graph.
+  void Link(Vertex u, Vertex v);
+  // Removes edge {`u`, `v`} from forest. The edge must be present in the
+  // forest.
+  void Cut(Vertex u, Vertex v);
+
+  // For each pair (u, v) in the `len`-length array `queries`, returns whether u
+  // and v are connected in the forest. The returned array should be freed with
+  // `delete[]`.
+  bool* BatchConnected(Edge* queries, Vertex len) const;
+  // Adds all edges in the `len`-length array `links` to the forest. Adding
+  // these edges must not create cycles in the graph.
+  void BatchLink(Edge* links, Vertex len);
+  // Removes all edges in the `len`-length array `cuts` from the forest. These
+  // edges must be present in the forest and must be distinct.
+  void BatchCut(Edge* cuts, Vertex len);
+
+ private:
+  using Element = _internal::TourElement<Sequence>;
+  using TourUpdates = _internal::BatchTourUpdates<SequenceEulerTourTree,
+      Sequence>;
+
+  // Hooks for `BatchTourUpdates`, which does the work of `BatchLink` and
+  // `BatchCut`. See batch_tour_updates.hpp.
+  friend TourUpdates;
+  Element* VertexElement(Vertex v) { return &vertices_[v]; }
+  // Allocates and constructs the element of an edge with its place in the
+  // sequence structure seeded by `random_int`.
+  Element* NewEdgeElement(size_t random_int, Vertex tail);
+  // Destroys and frees an edge element from `NewEdgeElement`.
+  void DeleteEdgeElement(Element* element);
+  void AfterJoins(const typename TourUpdates::Join*, size_t,
+      perf_counters::PhaseCounter*) {}
+
+  void BatchCutRecurse(Edge* cuts, Vertex len, bool* ignored,
+      Element** join_targets, Element** edge_elements);
+
+  Vertex num_vertices_;
+  // The elements of this forest, and the memory they hold, come from these.
+  // They are declared before the elements so that they outlive them.
+  typename Sequence::Allocators allocators_;
+  concurrent_array_allocator::Pool edge_allocator_;
+  Element* vertices_;
+  _internal::EdgeMap<Vertex, Element> edges_;
+  parlay::random randomness_;
+};
+
+using SkipListEulerTourTree = SequenceEulerTourTree<SkipListSequence>;
+using AugmentedSkipListEulerTourTree =
+    SequenceEulerTourTree<AugmentedSkipListSequence>;
+using TreapEulerTourTree = SequenceEulerTourTree<TreapSequence>;
+
+}  // namespace parallel_euler_tour_tree
@@ -0,0 +1,219 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <utility>
+
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+#include <psl/augmented_skip_list.hpp>
+#include <psl/skip_list.hpp>
+#include <sequence/parallel_treap/include/treap.hpp>
+
+namespace parallel_euler_tour_tree {
+
+// Sequence policies for `SequenceEulerTourTree` and for the batch updates in
+// batch_tour_updates.hpp. A policy names the type `Node` that tour elements
+// derive from and gives static operations on circular sequences of nodes:
+//
+// - `Allocators` holds the allocators of one forest's nodes. Destroying it
+//   releases the memory of the nodes that were constructed with it.
+// - `Construct<T>(where, random_int, allocators)` constructs a `T`, which
+//   derives from `Node` and takes the same constructor arguments, at `where`,
+//   with its height or priority seeded by `random_int` and its memory beyond
+//   `sizeof(T)` taken from `allocators`.
+// - `MakeCycle(node)` makes a newly constructed node into a circular sequence
+//   of one node.
+// - `GetNext(node)` and `GetPrevious(node)` step around a circular sequence.
+// - `FindRepresentative(node)` returns the same node for all nodes of a
+//   circular sequence until the sequence is next updated.
+// - `BatchSplit(splits, len)` cuts circular sequences open right after each of
+//   the `len` distinct nodes in `splits`, leaving linear sequences.
+// - `BatchJoin(joins, len)` joins, for each pair in the `len`-length array
+//   `joins`, the linear sequence ending at the first node to the one starting
+//   at the second. A join of a sequence to itself makes it circular.
+
+// Phase-concurrent skip list, which splits and joins each place independently.
+// `SkipListElement` is `parallel_skip_list::Element` or another
+// `parallel_skip_list::ElementBase`.
+template <typename SkipListElement>
+struct BasicSkipListSequence {
+  using Node = SkipListElement;
+  struct Allocators {
+    typename Node::NeighborAllocator neighbors;
+  };
+
+  template <typename T>
+  static T* Construct(void* where, size_t random_int, Allocators* allocators) {
+    return new (where) T{random_int, &allocators->neighbors};
+  }
+  static void MakeCycle(Node* node) { Node::Join(node, node); }
+  static Node* GetNext(const Node* node) { return node->GetNextElement(); }
+  static Node* GetPrevious(const Node* node) {
+    return node->GetPreviousElement();
+  }
+  static const Node* FindRepresentative(const Node* node) {
+    return node->FindRepresentative();
+  }
+  static void BatchSplit(Node** splits, size_t len) {
+    parlay::parallel_for(0, len, [&](size_t i) { splits[i]->Split(); });
+  }
+  static void BatchJoin(std::pair<Node*, Node*>* joins, size_t len) {
+    parlay::parallel_for(0, len, [&](size_t i) {
+      Node::Join(joins[i].first, joins[i].second);
+    });
+  }
+};
+
+using SkipListSequence = BasicSkipListSequence<parallel_skip_list::Element>;
+
+// Augmented skip list (`parallel_skip_list::AugmentedElement`), which also
+// keeps the size of each sequence at the cost of a pass over the ancestors of
+// the changed places after each batch.
+struct AugmentedSkipListSequence {
+  using Node = parallel_skip_list::AugmentedElement;
+  struct Allocators {
+    Node::NeighborAllocator neighbors;
+    Node::ValueAllocator values;
+  };
+
+  template <typename T>
+  static T* Construct(void* where, size_t random_int, Allocators* allocators) {
+    return new (where)
+        T{random_int, &allocators->neighbors, &allocators->values};
+  }
+  static void MakeCycle(Node* node) {
+    std::pair<Node*, Node*> join{node, node};
+    Node::BatchJoin(&join, 1);
+  }
+  static Node* GetNext(const Node* node) { return node->GetNextElement(); }
+  static Node* GetPrevious(const Node* node) {
+    return node->GetPreviousElement();
+  }
+  static const Node* FindRepresentative(const Node* node) {
+    return node->FindRepresentative();
+  }
+  static void BatchSplit(Node** splits, size_t len) {
+    Node::BatchSplit(splits, static_cast<int>(len));
+  }
+  static void BatchJoin(std::pair<Node*, Node*>* joins, size_t len) {
+    Node::BatchJoin(joins, static_cast<int>(len));
+  }
+};
+
+// Parallel treap (`treap::Node`). Treaps only hold linear sequences, so a
+// circular sequence is held as a linear one starting at an arbitrary node, and
+// stepping between nodes goes through ranks in O(log n) expected time.
+struct TreapSequence {
+  using Node = treap::Node;
+  // Treap nodes hold no memory beyond themselves.
+  struct Allocators {};
+
+  template <typename T>
+  static T* Construct(void* where, size_t random_int, Allocators*) {
+    return new (where) T{random_int};
+  }
+  static void MakeCycle(Node*) {}
+  static Node* GetNext(const Node* node) {
+    const size_t rank{node->GetRank()};
+    return node->Select(rank + 1 == node->GetSize() ? 0 : rank + 1);
+  }
+  static Node* GetPrevious(const Node* node) {
+    const size_t rank{node->GetRank()};
+    return node->Select(rank == 0 ? node->GetSize() - 1 : rank - 1);
+  }
+  static const Node* FindRepresentative(const Node* node) {
+    return node->GetRoot();
+  }
+  static void BatchSplit(Node** splits, size_t len);
+  static void BatchJoin(std::pair<Node*, Node*>* joins, size_t len);
+};
+
+// Implementation: Split the linear sequences. Where a sequence was not split
+// after its last node, the piece ending at its last node comes before the
+// piece starting at its first node in the circular sequence, so join those
+// back up.
+inline void TreapSequence::BatchSplit(Node** splits, size_t len) {
+  parlay::sequence<std::pair<Node*, Node*>> splits_by_root{parlay::tabulate(
+      len, [&](size_t i) {
+        return std::make_pair(splits[i]->GetRoot(), splits[i]);
+      })};
+  parlay::sort_inplace(splits_by_root);
+  // Roots of the sequences that are split after their last node, in order.
+  const parlay::sequence<Node*> roots_split_at_end{parlay::map(
+      parlay::filter(splits_by_root,
+          [](const std::pair<Node*, Node*>& split) {
+            const Node* node{split.second};
+            return node->GetRank() + 1 == node->GetSize();
+          }),
+      [](const std::pair<Node*, Node*>& split) { return split.first; })};
+  const parlay::sequence<size_t> root_starts{parlay::pack_index(
+      parlay::delayed_seq<bool>(len, [&](size_t i) {
+        return i == 0 || splits_by_root[i].first != splits_by_root[i - 1].first;
+      }))};
+  parlay::sequence<std::pair<Node*, Node*>> wraps{parlay::tabulate(
+      root_starts.size(), [&](size_t i) {
+        Node* root{splits_by_root[root_starts[i]].first};
+        if (std::binary_search(
+              roots_split_at_end.begin(), roots_split_at_end.end(), root)) {
+          return std::pair<Node*, Node*>{nullptr, nullptr};
+        }
+        return std::make_pair(root->Select(root->GetSize() - 1),
+            root->Select(0));
+      })};
+
+  Node::BatchSplit(splits, static_cast<int>(len));
+  parlay::sequence<std::pair<Node*, Node*>> wrap_joins{parlay::filter(wraps,
+      [](const std::pair<Node*, Node*>& join) {
+        return join.first != nullptr;
+      })};
+  Node::BatchJoin(wrap_joins.data(), static_cast<int>(wrap_joins.size()));
+}
+
+// Implementation: The joins chain the sequences into paths and cycles, and each
+// cycle must stay one linear sequence. Following the chains by pointer jumping,
+// find the joins that lie on cycles and the least index of a join on each
+// cycle, and leave out the join with that index.
+inline void TreapSequence::BatchJoin(
+    std::pair<Node*, Node*>* joins, size_t len) {
+  constexpr size_t kNone{std::numeric_limits<size_t>::max()};
+  parlay::sequence<std::pair<Node*, size_t>> joins_by_left_root{
+      parlay::tabulate(len, [&](size_t i) {
+        return std::make_pair(joins[i].first->GetRoot(), i);
+      })};
+  parlay::sort_inplace(joins_by_left_root);
+  // `next[i]` is the join that continues the chain after join i, if any.
+  parlay::sequence<size_t> next{parlay::tabulate(len, [&](size_t i) {
+    Node* right_root{joins[i].second->GetRoot()};
+    const auto it{std::lower_bound(joins_by_left_root.begin(),
+        joins_by_left_root.end(), std::make_pair(right_root, size_t{0}))};
+    return it != joins_by_left_root.end() && it->first == right_root ?
+        it->second : kNone;
+  })};
+  parlay::sequence<size_t> least_index{
+      parlay::tabulate(len, [](size_t i) { return i; })};
+  for (size_t reach = 1; reach < len; reach *= 2) {
+    parlay::sequence<size_t> new_least_index{parlay::tabulate(len,
+        [&](size_t i) {
+          return next[i] == kNone ?
+              least_index[i] : std::min(least_index[i], least_index[next[i]]);
+        })};
+    parlay::sequence<size_t> new_next{parlay::tabulate(len, [&](size_t i) {
+      return next[i] == kNone ? kNone : next[next[i]];
+    })};
+    least_index = std::move(new_least_index);
+    next = std::move(new_next);
+  }
+
+  parlay::sequence<std::pair<Node*, Node*>> kept_joins{parlay::pack(
+      parlay::make_slice(joins, joins + len),
+      parlay::delayed_seq<bool>(len, [&](size_t i) {
+        return next[i] == kNone || least_index[i] != i;
+      }))};
+  Node::BatchJoin(kept_joins.data(), static_cast<int>(kept_joins.size()));
+}
+
+}  // namespace parallel_euler_tour_tree
@@ -0,0 +1,299 @@
+#pragma once
+
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+#include <psl/perf_counters.hpp>
+
+namespace parallel_euler_tour_tree {
+
+namespace _internal {
+
+// Batch link and batch cut on Euler tours kept in the sequences of `Sequence`,
+// one of the policies in sequence_policies.hpp. These are shared by
+// `BasicEulerTourTree` and `SequenceEulerTourTree`. All the splits and all the
+// joins of a batch each go to the sequence structure as a single batch, which
+// lets sequence structures like the treap, whose splits and joins on a tree
+// must not run concurrently, apply them in parallel.
+//
+// `Forest` befriends this class and provides:
+// - the types `Edge`, a pair of vertex IDs, and `Element`, which derives from
+//   `Sequence::Node` and has `twin_`, `split_mark_`, `GetNextElement()`, and
+//   `GetPreviousElement()`;
+// - `VertexElement(v)`, which returns the element (v, v) of vertex v;
+// - `NewEdgeElement(random_int, tail)` and `DeleteEdgeElement(element)`, which
+//   allocate and free the elements of edges;
+// - `AfterJoins(joins, len, phases)`, which is called after each batch of joins
+//   with the `len` pairs that were joined;
+// - the members `edges_`, the `EdgeMap` of the forest's edges, and
+//   `randomness_`.
+template <typename Forest, typename Sequence>
+class BatchTourUpdates {
+ public:
+  using Edge = typename Forest::Edge;
+  using Vertex = typename Edge::first_type;
+  using Element = typename Forest::Element;
+  using Node = typename Sequence::Node;
+  using Join = std::pair<Node*, Node*>;
+
+  // On `BatchCutRound`, randomly ignore 1/`kBatchCutRecursiveFactor` cuts so
+  // that they are cut in a later round.
+  static constexpr int kBatchCutRecursiveFactor{100};
+
+  // Adds all edges in the `len`-length array `links` to `forest`. The steps are
+  // recorded in `phases` as the "sort", "split", "allocate/insert", and "join"
+  // phases.
+  static void BatchLink(Forest* forest, Edge* links, Vertex len,
+      perf_counters::PhaseCounter* phases);
+
+  // Sets `ignored[i]` to true for a random subset of the `len` edges in `cuts`
+  // and cuts the other edges from `forest`. The caller should cut the ignored
+  // edges in a later round. `join_targets` and `edge_elements` are scratch
+  // space as described for `SpliceOutCuts`. The steps are recorded in `phases`
+  // as the "mark" and "find join targets" phases and the phases of
+  // `SpliceOutCuts`.
+  static void BatchCutRound(Forest* forest, Edge* cuts, Vertex len,
+      bool* ignored, Element** join_targets, Element** edge_elements,
+      perf_counters::PhaseCounter* phases);
+
+  // Splits out and frees the elements of every edge `cuts[i]` with `ignored[i]`
+  // false (or of every edge if `ignored` is null), then joins the pairs in
+  // `join_targets` to close up the tours.
+  //
+  // `edge_elements[i]` is the element of `cuts[i]`, and these elements and
+  // their twins must be marked with `split_mark_`. For each cut element e =
+  // (x, y), if the element before e is not cut, then it and the first uncut
+  // element after (y, x) are the pair `join_targets[4i]` and
+  // `join_targets[4i + 1]` for e = `edge_elements[i]`, or `join_targets[4i + 2]`
+  // and `join_targets[4i + 3]` for its twin. Otherwise, `join_targets[4i]`
+  // (respectively `join_targets[4i + 2]`) is null.
+  //
+  // The steps are recorded in `phases` as the "split" and "free/join" phases.
+  static void SpliceOutCuts(Forest* forest, Edge* cuts, Vertex len,
+      const bool* ignored, Element** join_targets, Element** edge_elements,
+      perf_counters::PhaseCounter* phases);
+
+ private:
+  // Writes the join targets of cut element `e` to `targets[0]` and
+  // `targets[1]` as described for `SpliceOutCuts`.
+  static void FindJoinTargets(Element* e, Element** targets);
+};
+
+// Implementation: For each added edge {x, y}, allocate elements (x, y) and
+// (y, x). For each vertex x that shows up in an added edge, split on (x, x).
+// Let succ(x) denote the successor of (x, x) prior to splitting.
+// For each vertex x, identify which y_1, y_2, ... y_k that x will be newly
+// connected to by sorting {(x, y), (y, x) : {x, y} is an added edge}.
+// If x has new neighbors y_1, y_2, ..., y_k, join (x, x) to (x, y_1). Join
+// (y_i, x) to (x, y_{i+1}) for each i < k. Join (y_k, x) to succ(x).
+template <typename Forest, typename Sequence>
+void BatchTourUpdates<Forest, Sequence>::BatchLink(Forest* forest, Edge* links,
+    Vertex len, perf_counters::PhaseCounter* phases) {
+  phases->Start("sort");
+  const size_t num_link_elements{2 * static_cast<size_t>(len)};
+  parlay::sequence<Edge> links_both_dirs{parlay::tabulate(num_link_elements,
+      [&](size_t i) {
+        const Edge& link{links[i / 2]};
+        return i % 2 == 0 ? link : std::make_pair(link.second, link.first);
+      })};
+  parlay::integer_sort_inplace(links_both_dirs, [](const Edge& link) {
+    return static_cast<std::make_unsigned_t<Vertex>>(link.first);
+  });
+  const auto is_group_start{[&](size_t i) {
+    return i == 0 || links_both_dirs[i].first != links_both_dirs[i - 1].first;
+  }};
+  const auto is_group_end{[&](size_t i) {
+    return i == num_link_elements - 1 ||
+        links_both_dirs[i].first != links_both_dirs[i + 1].first;
+  }};
+
+  phases->Start("split");
+  // split on each vertex that appears in the input
+  const parlay::sequence<Element*> split_successors{parlay::tabulate(
+      num_link_elements, [&](size_t i) -> Element* {
+        return is_group_end(i) ?
+            forest->VertexElement(links_both_dirs[i].first)->GetNextElement() :
+            nullptr;
+      })};
+  parlay::sequence<Node*> splits{parlay::map(
+      parlay::pack_index(parlay::delayed_seq<bool>(num_link_elements,
+          is_group_end)),
+      [&](size_t i) -> Node* {
+        return forest->VertexElement(links_both_dirs[i].first);
+      })};
+  Sequence::BatchSplit(splits.data(), splits.size());
+
+  phases->Start("allocate/insert");
+  forest->edges_.PrepareInsertions(len);
+  parlay::parallel_for(0, num_link_elements, [&](size_t i) {
+    Vertex u, v;
+    std::tie(u, v) = links_both_dirs[i];
+
+    // allocate edge element
+    if (u < v) {
+      Element* uv{forest->NewEdgeElement(forest->randomness_.ith_rand(2 * i),
+          u)};
+      Element* vu{forest->NewEdgeElement(
+          forest->randomness_.ith_rand(2 * i + 1), v)};
+      uv->twin_ = vu;
+      vu->twin_ = uv;
+      forest->edges_.Insert(u, v, uv);
+    }
+  });
+  forest->randomness_ = forest->randomness_.next();
+
+  phases->Start("join");
+  // For `links_both_dirs[i]` = (x, y), join 2i joins (x, x) to (x, y) if y is
+  // the first new neighbor of x, and join 2i + 1 joins (y, x) onwards.
+  parlay::sequence<Join> joins{parlay::filter(parlay::delayed_seq<Join>(
+      2 * num_link_elements, [&](size_t j) {
+        const size_t i{j / 2};
+        Vertex u, v;
+        std::tie(u, v) = links_both_dirs[i];
+        Element* uv{forest->edges_.Find(u, v)};
+        if (j % 2 == 0) {
+          return is_group_start(i) ?
+              Join{forest->VertexElement(u), uv} : Join{nullptr, nullptr};
+        }
+        Element* next{is_group_end(i) ?
+            split_successors[i] :
+            forest->edges_.Find(links_both_dirs[i + 1].first,
+                links_both_dirs[i + 1].second)};
+        return Join{uv->twin_, next};
+      }),
+      [](const Join& join) { return join.first != nullptr; })};
+  Sequence::BatchJoin(joins.data(), joins.size());
+  forest->AfterJoins(joins.data(), joins.size(), phases);
+}
+
+template <typename Forest, typename Sequence>
+void BatchTourUpdates<Forest, Sequence>::FindJoinTargets(
+    Element* e, Element** targets) {
+  Element* left_target{e->GetPreviousElement()};
+  if (left_target->split_mark_) {
+    targets[0] = nullptr;
+    return;
+  }
+  Element* right_target{e->twin_->GetNextElement()};
+  while (right_target->split_mark_) {
+    right_target = right_target->twin_->GetNextElement();
+  }
+  targets[0] = left_target;
+  targets[1] = right_target;
+}
+
+// Implementation:
+// Notation: "(x, y).next" is the next element in the tour (x, y) is in. "(x,
+// y).prev" is the previous element. "(x, y).twin" is (y, x).
+// For each edge {x, y} to cut:
+// Sequentially, we'd want to join (y, x).prev to (x, y).next and (x, y).prev
+// to (y, x).next. We can't correctly do this if any of those four elements
+// are to be cut and removed as well. Instead, for dealing with connecting (y,
+// x).prev to (x, y).next (dealing with connecting (x, y).prev to (y, x).next
+// is symmetric), we do the following:
+// - If (y, x).prev is to be cut, then do nothing --- some other thread will
+// deal with this.
+// - Otherwise, start with element e = (x, y).next. So long as e is to be cut,
+// traverse to the next possible join location at e := e.next.twin. Join
+// (y, x).prev to e.
+// This strategy doesn't have good depth since we may have to traverse on e
+// for a long time. To fix this, we randomly ignore some cuts so that all
+// traversal lengths are O(log n) with high probability. We perform all
+// unignored cuts as described above, and the caller cuts the ignored cuts
+// afterwards.
+template <typename Forest, typename Sequence>
+void BatchTourUpdates<Forest, Sequence>::BatchCutRound(Forest* forest,
+    Edge* cuts, Vertex len, bool* ignored, Element** join_targets,
+    Element** edge_elements, perf_counters::PhaseCounter* phases) {
+  phases->Start("mark");
+  parlay::parallel_for(0, len, [&](size_t i) {
+    ignored[i] =
+        forest->randomness_.ith_rand(i) % kBatchCutRecursiveFactor == 0;
+
+    if (!ignored[i]) {
+      Vertex u, v;
+      std::tie(u, v) = cuts[i];
+      Element* uv{forest->edges_.Find(u, v)};
+      edge_elements[i] = uv;
+      Element* vu{uv->twin_};
+      uv->split_mark_ = vu->split_mark_ = true;
+    }
+  });
+  forest->randomness_ = forest->randomness_.next();
+
+  phases->Start("find join targets");
+  parlay::parallel_for(0, len, [&](size_t i) {
+    if (!ignored[i]) {
+      Element* uv{edge_elements[i]};
+      FindJoinTargets(uv, &join_targets[4 * i]);
+      FindJoinTargets(uv->twin_, &join_targets[4 * i + 2]);
+    }
+  });
+
+  SpliceOutCuts(forest, cuts, len, ignored, join_targets, edge_elements,
+      phases);
+}
+
+template <typename Forest, typename Sequence>
+void BatchTourUpdates<Forest, Sequence>::SpliceOutCuts(Forest* forest,
+    Edge* cuts, Vertex len, const bool* ignored, Element** join_targets,
+    Element** edge_elements, perf_counters::PhaseCounter* phases) {
+  const auto is_cut{[&](size_t i) {
+    return ignored == nullptr || !ignored[i];
+  }};
+
+  phases->Start("split");
+  // Split right after each cut element, and right after its predecessor if the
+  // predecessor is not cut too, in which case the predecessor is its left join
+  // target.
+  parlay::sequence<Node*> splits{parlay::filter(parlay::delayed_seq<Node*>(
+      4 * static_cast<size_t>(len), [&](size_t j) -> Node* {
+        const size_t i{j / 4};
+        if (!is_cut(i)) {
+          return nullptr;
+        }
+        if (j % 2 == 1) {
+          return join_targets[4 * i + 2 * (j % 4 / 2)];
+        }
+        Element* uv{edge_elements[i]};
+        return j % 4 == 0 ? uv : uv->twin_;
+      }),
+      [](const Node* split) { return split != nullptr; })};
+  Sequence::BatchSplit(splits.data(), splits.size());
+
+  phases->Start("free/join");
+  parlay::parallel_for(0, len, [&](size_t i) {
+    if (is_cut(i)) {
+      // Here we must use `edge_elements[i]` instead of `edges_.Find(u, v)`
+      // because the concurrent hash table cannot handle simultaneous lookups
+      // and deletions.
+      Element* uv{edge_elements[i]};
+      Element* vu{uv->twin_};
+      forest->DeleteEdgeElement(uv);
+      forest->DeleteEdgeElement(vu);
+      Vertex u, v;
+      std::tie(u, v) = cuts[i];
+      forest->edges_.Delete(u, v);
+    }
+  });
+  // Join 2i + k joins the targets `join_targets[4i + 2k]` and
+  // `join_targets[4i + 2k + 1]`.
+  parlay::sequence<Join> joins{parlay::filter(parlay::delayed_seq<Join>(
+      2 * static_cast<size_t>(len), [&](size_t j) {
+        return is_cut(j / 2) && join_targets[2 * j] != nullptr ?
+            Join{join_targets[2 * j], join_targets[2 * j + 1]} :
+            Join{nullptr, nullptr};
+      }),
+      [](const Join& join) { return join.first != nullptr; })};
+  Sequence::BatchJoin(joins.data(), joins.size());
+  forest->AfterJoins(joins.data(), joins.size(), phases);
+}
+
+}  // namespace _internal
+
+}  // namespace parallel_euler_tour_tree
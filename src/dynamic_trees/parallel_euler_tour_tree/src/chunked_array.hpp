@@ -0,0 +1,96 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+
+#include <parlay/utilities.h>
+#include <psl/utils.h>
+
+namespace parallel_euler_tour_tree {
+
+namespace _internal {
+
+// Array that grows by allocating more chunks, so that growing never moves
+// existing entries. Chunk 0 holds indices [0, B), where B is the initial
+// capacity rounded up to a power of two, and chunk i > 0 holds indices [B *
+// 2^(i - 1), B * 2^i), so that each chunk doubles the capacity.
+//
+// Entries are neither constructed nor destroyed by the array.
+template <typename T>
+class ChunkedArray {
+ public:
+  ChunkedArray() = delete;
+  explicit ChunkedArray(size_t initial_capacity)
+    : base_log_{static_cast<int>(
+          parlay::log2_up(initial_capacity > 0 ? initial_capacity : 1))} {
+    chunks_[0] = new_array_no_init<T>(size_t{1} << base_log_);
+  }
+  ~ChunkedArray() {
+    for (int i = 0; i < num_chunks_; i++) {
+      free(chunks_[i]);
+    }
+  }
+  ChunkedArray(const ChunkedArray&) = delete;
+  ChunkedArray(ChunkedArray&&) = delete;
+  ChunkedArray& operator=(const ChunkedArray&) = delete;
+  ChunkedArray& operator=(ChunkedArray&&) = delete;
+
+  T& operator[](size_t i) const {
+    const size_t chunk_index{i >> base_log_};
+    const int chunk{chunk_index == 0 ? 0 : 64 - __builtin_clzll(chunk_index)};
+    return chunks_[chunk][i - ChunkStart(chunk)];
+  }
+
+  size_t Capacity() const { return ChunkStart(num_chunks_); }
+
+  // Allocates chunks until the capacity is at least `capacity`.
+  void Reserve(size_t capacity) {
+    while (Capacity() < capacity) {
+      chunks_[num_chunks_] = new_array_no_init<T>(Capacity());
+      num_chunks_++;
+    }
+  }
+
+  // Calls `f(first, entries, length)` for each run of entries within indices
+  // [`begin`, `end`) that are contiguous in memory, where the run holds the
+  // `length` entries from index `first` on and starts at `entries`. `end` must
+  // be at most `Capacity()`.
+  template <typename F>
+  void ForEachContiguousRange(size_t begin, size_t end, F f) const {
+    for (int i = 0; i < num_chunks_ && begin < end; i++) {
+      const size_t chunk_end{std::min(ChunkStart(i + 1), end)};
+      if (begin < chunk_end) {
+        f(begin, chunks_[i] + (begin - ChunkStart(i)), chunk_end - begin);
+        begin = chunk_end;
+      }
+    }
+  }
+
+  // Returns the index of the entry that `p` points to, or -1 if `p` does not
+  // point into the array.
+  long long IndexOf(const T* p) const {
+    for (int i = 0; i < num_chunks_; i++) {
+      const size_t chunk_length{ChunkStart(i + 1) - ChunkStart(i)};
+      if (chunks_[i] <= p && p < chunks_[i] + chunk_length) {
+        return ChunkStart(i) + (p - chunks_[i]);
+      }
+    }
+    return -1;
+  }
+
+ private:
+  static constexpr int kMaxChunks{48};
+
+  size_t ChunkStart(int chunk) const {
+    return ((size_t{1} << chunk) >> 1) << base_log_;
+  }
+
+  int base_log_;
+  int num_chunks_{1};
+  T* chunks_[kMaxChunks];
+};
+
+}  // namespace _internal
+
+}  // namespace parallel_euler_tour_tree
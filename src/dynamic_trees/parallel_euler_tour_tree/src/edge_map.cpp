@@ -1,57 +1,195 @@
 #include <dynamic_trees/parallel_euler_tour_tree/src/edge_map.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <utility>
 
+#include <dynamic_trees/parallel_euler_tour_tree/include/sequence_policies.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/src/tour_element.hpp>
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+#include <parlay/utilities.h>
+#include <psl/utils.h>
+#include <utilities/include/hash_pair.hpp>
+
 namespace parallel_euler_tour_tree {
 
 namespace _internal {
 
-EdgeMap::EdgeMap(int num_vertices)
-    : map_{nullptr, static_cast<size_t>(num_vertices - 1),
-          std::make_pair(-1, -1), std::make_pair(-2, -2)} {}
+namespace {
+
+  template <typename Vertex>
+  const std::pair<Vertex, Vertex> kEmptyKey{-1, -1};
+  template <typename Vertex>
+  const std::pair<Vertex, Vertex> kTombstone{-2, -2};
+
+  size_t CapacityForVertices(size_t num_vertices) {
+    return size_t{1} << parlay::log2_up(
+        100 + static_cast<size_t>(1.1 * (num_vertices - 1)));
+  }
+
+}  // namespace
+
+template <typename Vertex, typename ElementType>
+EdgeMap<Vertex, ElementType>::EdgeMap(
+    Vertex num_vertices, numa_placement::Policy numa_policy)
+    : capacity_{CapacityForVertices(num_vertices)}
+    , table_placement_{numa_policy == numa_placement::Policy::kFirstTouch
+          ? numa_placement::Policy::kFirstTouch
+          : numa_placement::Policy::kInterleaved} {
+  AllocateTable();
+}
+
+template <typename Vertex, typename ElementType>
+void EdgeMap<Vertex, ElementType>::AllocateTable() {
+  table_ = new_array_no_init<Entry>(capacity_);
+  numa_placement::Place(table_, capacity_ * sizeof(Entry), table_placement_);
+  parlay::parallel_for(0, capacity_, [&](size_t i) {
+    table_[i].key = kEmptyKey<Vertex>;
+  });
+}
+
+template <typename Vertex, typename ElementType>
+void EdgeMap<Vertex, ElementType>::Reserve(Vertex num_vertices) {
+  const size_t new_capacity{CapacityForVertices(num_vertices)};
+  if (new_capacity <= capacity_) {
+    return;
+  }
+  Rehash(new_capacity);
+}
+
+template <typename Vertex, typename ElementType>
+void EdgeMap<Vertex, ElementType>::PrepareInsertions(size_t k) {
+  num_used_slots_ += k;
+  if (num_used_slots_ <= capacity_ / 4 * 3) {
+    return;
+  }
+  const size_t num_live{parlay::count_if(
+      parlay::make_slice(table_, table_ + capacity_),
+      [](const Entry& entry) { return entry.key.first >= 0; })};
+  Rehash(std::max(
+      capacity_, size_t{1} << parlay::log2_up(2 * (num_live + k))));
+  num_used_slots_ = num_live + k;
+}
+
+template <typename Vertex, typename ElementType>
+void EdgeMap<Vertex, ElementType>::Clear() {
+  parlay::parallel_for(0, capacity_, [&](size_t i) {
+    table_[i].key = kEmptyKey<Vertex>;
+  });
+  num_used_slots_ = 0;
+}
+
+template <typename Vertex, typename ElementType>
+void EdgeMap<Vertex, ElementType>::Rehash(size_t new_capacity) {
+  Entry* old_table{table_};
+  const size_t old_capacity{capacity_};
+  capacity_ = new_capacity;
+  AllocateTable();
+  parlay::parallel_for(0, old_capacity, [&](size_t i) {
+    const std::pair<Vertex, Vertex> key{old_table[i].key};
+    if (key != kEmptyKey<Vertex> && key != kTombstone<Vertex>) {
+      Insert(key.first, key.second, old_table[i].value);
+    }
+  });
+  delete_array(old_table, old_capacity);
+}
+
+template <typename Vertex, typename ElementType>
+EdgeMap<Vertex, ElementType>::~EdgeMap() {
+  delete_array(table_, capacity_);
+}
 
-EdgeMap::~EdgeMap() {
-  map_.del();
+template <typename Vertex, typename ElementType>
+size_t EdgeMap<Vertex, ElementType>::FirstIndex(
+    const std::pair<Vertex, Vertex>& key) const {
+  return HashIntPairStruct{}(key) & (capacity_ - 1);
 }
 
-bool EdgeMap::Insert(int u, int v, Element* edge) {
+template <typename Vertex, typename ElementType>
+size_t EdgeMap<Vertex, ElementType>::NextIndex(size_t index) const {
+  return (index + 1) & (capacity_ - 1);
+}
+
+template <typename Vertex, typename ElementType>
+typename EdgeMap<Vertex, ElementType>::Entry*
+EdgeMap<Vertex, ElementType>::FindEntry(
+    const std::pair<Vertex, Vertex>& key) const {
+  // Stop after one pass over the table in case it holds no empty slots.
+  size_t i{FirstIndex(key)};
+  for (size_t j = 0; j < capacity_; j++, i = NextIndex(i)) {
+    const std::pair<Vertex, Vertex> table_key{table_[i].key};
+    if (table_key == key) {
+      return &table_[i];
+    } else if (table_key == kEmptyKey<Vertex>) {
+      return nullptr;
+    }
+  }
+  return nullptr;
+}
+
+template <typename Vertex, typename ElementType>
+bool EdgeMap<Vertex, ElementType>::Insert(Vertex u, Vertex v, Element* edge) {
   if (u > v) {
     std::swap(u, v);
     edge = edge->twin_;
   }
-  return map_.insert(make_pair(u, v), edge);
+  const std::pair<Vertex, Vertex> key{u, v};
+  size_t i{FirstIndex(key)};
+  for (size_t j = 0; j < capacity_; j++, i = NextIndex(i)) {
+    const std::pair<Vertex, Vertex> table_key{table_[i].key};
+    if ((table_key == kEmptyKey<Vertex> || table_key == kTombstone<Vertex>) &&
+        CAS(&table_[i].key, table_key, key)) {
+      table_[i].value = edge;
+      return true;
+    } else if (table_key == key) {
+      return false;
+    }
+  }
+  return false;
 }
 
-bool EdgeMap::Delete(int u, int v) {
+template <typename Vertex, typename ElementType>
+bool EdgeMap<Vertex, ElementType>::Delete(Vertex u, Vertex v) {
   if (u > v) {
     std::swap(u, v);
   }
-  return map_.deleteVal(make_pair(u, v));
+  Entry* entry{FindEntry(std::make_pair(u, v))};
+  if (entry == nullptr) {
+    return false;
+  }
+  entry->key = kTombstone<Vertex>;
+  return true;
 }
 
-Element* EdgeMap::Find(int u, int v) {
+template <typename Vertex, typename ElementType>
+ElementType* EdgeMap<Vertex, ElementType>::Find(Vertex u, Vertex v) const {
   if (u > v) {
-    Element* vu{*map_.find(make_pair(v, u))};
-    return vu == nullptr ? nullptr : vu->twin_;
+    const Entry* vu{FindEntry(std::make_pair(v, u))};
+    return vu == nullptr ? nullptr : vu->value->twin_;
   } else {
-    return *map_.find(make_pair(u, v));
+    const Entry* uv{FindEntry(std::make_pair(u, v))};
+    return uv == nullptr ? nullptr : uv->value;
   }
 }
 
-void EdgeMap::FreeElements(list_allocator<Element>* allocator) {
-  parallel_for (size_t i = 0; i < map_.capacity; i++) {
-    auto kv{map_.table[i]};
-    auto key{get<0>(kv)};
-    if (key != map_.empty_key && key != map_.tombstone) {
-      Element* element{get<1>(kv)};
-      element->twin_->~Element();
-      allocator->free(element->twin_);
-      element->~Element();
-      allocator->free(element);
-    }
-  }
+template <typename Vertex, typename ElementType>
+parlay::sequence<ElementType*>
+EdgeMap<Vertex, ElementType>::Elements() const {
+  const parlay::sequence<size_t> indices{parlay::pack_index<size_t>(
+      parlay::delayed_seq<bool>(capacity_, [&](size_t i) {
+        return table_[i].key.first >= 0;
+      }))};
+  return parlay::map(indices, [&](size_t i) { return table_[i].value; });
 }
 
+template class EdgeMap<int32_t>;
+template class EdgeMap<int64_t>;
+template class EdgeMap<int32_t, TourElement<SkipListSequence>>;
+template class EdgeMap<int32_t, TourElement<AugmentedSkipListSequence>>;
+template class EdgeMap<int32_t, TourElement<TreapSequence>>;
+
 }  // namespace _internal
 
 }  // namespace parallel_euler_tour_tree
@@ -2,39 +2,119 @@
 
 #include <utility>
 
-#include <utilities/include/concurrentMap.h>
-#include <utilities/include/hash_pair.hpp>
-#include <utilities/include/list_allocator.h>
+#include <parlay/parallel.h>
+#include <parlay/sequence.h>
 #include <dynamic_trees/parallel_euler_tour_tree/src/euler_tour_sequence.hpp>
+#include <psl/numa_placement.hpp>
 
 namespace parallel_euler_tour_tree {
 
 namespace _internal {
 
-// Used in Euler tour tree for mapping directed edges (pairs of ints) to the
-// sequence element in the Euler tour representing the edge.
+// Used in Euler tour tree for mapping directed edges (pairs of `Vertex`s) to
+// the sequence element in the Euler tour representing the edge. Elements have
+// type `ElementType`, which must have a `twin_` pointer.
 //
 // Only one of (u, v) and (v, u) should be added to the map; we can find the
 // other edge using the `twin_` pointer in `Element`.
+//
+// The map is a phase-concurrent linear-probing hash table: insertions may run
+// concurrently with each other, and so may deletions and lookups, but
+// insertions, deletions, and lookups must not be mixed.
+//
+// Deleted entries leave tombstones that keep their slots until the table is
+// rehashed, so every batch of insertions must be preceded by a call to
+// `PrepareInsertions` that covers it, which rehashes the table once it fills
+// up with live entries and tombstones.
+//
+// Keys are hashed, so entries have no affinity to NUMA nodes. Under any
+// `numa_policy` other than first touch, the table is interleaved over the
+// nodes.
+template <typename Vertex, typename ElementType = _internal::Element<Vertex>>
 class EdgeMap {
  public:
+  using Element = ElementType;
+
   EdgeMap() = delete;
-  explicit EdgeMap(int num_vertices);
+  explicit EdgeMap(Vertex num_vertices,
+      numa_placement::Policy numa_policy =
+          numa_placement::Policy::kFirstTouch);
   ~EdgeMap();
+  EdgeMap(const EdgeMap&) = delete;
+  EdgeMap(EdgeMap&&) = delete;
+  EdgeMap& operator=(const EdgeMap&) = delete;
+  EdgeMap& operator=(EdgeMap&&) = delete;
+
+  // Returns false if (u, v) is already in the map, or if the table is full,
+  // which insertions covered by `PrepareInsertions` never find.
+  bool Insert(Vertex u, Vertex v, Element* edge);
+  bool Delete(Vertex u, Vertex v);
+  // Returns the element of (u, v), or null if (u, v) is not in the map.
+  Element* Find(Vertex u, Vertex v) const;
 
-  bool Insert(int u, int v, Element* edge);
-  bool Delete(int u, int v);
-  Element* Find(int u, int v);
+  // Makes room for `k` more insertions. Once live entries, tombstones, and the
+  // `k` insertions could fill more than 3/4 of the table, this rehashes the
+  // table to clear the tombstones, growing it if needed so that the live
+  // entries fill at most half of it. The O(capacity) work of rehashing is
+  // amortized against the insertions since the last rehash. Must not run
+  // concurrently with other operations.
+  void PrepareInsertions(size_t k);
+  // Removes all entries. Must not run concurrently with other operations.
+  void Clear();
 
-  // Deallocate all elements held in the map. This assumes that all elements
-  // in the map were allocated through `allocator`.
-  void FreeElements(list_allocator<Element>* allocator);
+  // Calls `f(u, v, edge)` in parallel for each edge (u, v) in the map, where
+  // u < v and `edge` is the element of (u, v). Must not run concurrently with
+  // insertions or deletions.
+  template <typename F>
+  void ParallelForEach(F f) const;
+  // Returns the elements of all edges (u, v) in the map with u < v. Must not
+  // run concurrently with insertions or deletions.
+  parlay::sequence<Element*> Elements() const;
+
+  // Makes room for the edges of a forest on `num_vertices` vertices, rehashing
+  // into a larger table if needed. The table doubles in size at least, so that
+  // the work of rehashing is amortized against the added vertices. Must not run
+  // concurrently with other operations.
+  void Reserve(Vertex num_vertices);
 
  private:
-  concurrent_map::concurrentHT<
-      std::pair<int, int>, Element*, HashIntPairStruct> map_;
+  // Keys are claimed by CAS, so a key of two 64-bit IDs must be 16-byte
+  // aligned for CMPXCHG16B.
+  struct Entry {
+    alignas(2 * sizeof(Vertex)) std::pair<Vertex, Vertex> key;
+    Element* value;
+  };
+
+  // Allocates a `capacity_`-length table with all entries empty.
+  void AllocateTable();
+  // Moves the live entries into a new `new_capacity`-length table, leaving the
+  // tombstones behind.
+  void Rehash(size_t new_capacity);
+  size_t FirstIndex(const std::pair<Vertex, Vertex>& key) const;
+  size_t NextIndex(size_t index) const;
+  // Returns the table entry holding `key`, or null if there is none.
+  Entry* FindEntry(const std::pair<Vertex, Vertex>& key) const;
+
+  Entry* table_;
+  size_t capacity_;
+  // Upper bound on the number of live entries and tombstones in the table, as
+  // counted by `PrepareInsertions`.
+  size_t num_used_slots_{0};
+  numa_placement::Placement table_placement_;
 };
 
+template <typename Vertex, typename ElementType>
+template <typename F>
+void EdgeMap<Vertex, ElementType>::ParallelForEach(F f) const {
+  parlay::parallel_for(0, capacity_, [&](size_t i) {
+    // Empty and deleted entries have negative keys.
+    const std::pair<Vertex, Vertex> key{table_[i].key};
+    if (key.first >= 0) {
+      f(key.first, key.second, table_[i].value);
+    }
+  });
+}
+
 }  // namespace _internal
 
 }  // namespace parallel_euler_tour_tree
@@ -1,29 +1,251 @@
 #pragma once
 
-#include <sequence/parallel_skip_list/include/skip_list_base.hpp>
+#include <algorithm>
+#include <cstdint>
+
+#include <parlay/parallel.h>
+#include <psl/skip_list_base.hpp>
+#include <psl/utils.h>
 
 namespace parallel_euler_tour_tree {
 
 namespace _internal {
 
-class Element : public parallel_skip_list::ElementBase<Element> {
+// Element of an Euler tour in a forest whose vertex IDs have type `Vertex`.
+template <typename Vertex>
+class Element : public parallel_skip_list::ElementBase<Element<Vertex>> {
  public:
+  static constexpr int kNoUpdate{-1};
+
   Element() : parallel_skip_list::ElementBase<Element>{} {}
   explicit Element(size_t random_int)
     : parallel_skip_list::ElementBase<Element>{random_int} {}
+  Element(size_t random_int,
+      typename Element::NeighborAllocator* neighbor_allocator)
+    : parallel_skip_list::ElementBase<Element>{
+          random_int, neighbor_allocator} {}
+  ~Element() { DisableSums(); }
+
+  // Returns the next element on skip list level `level`, which must be less
+  // than `Height()`.
+  Element* GetNextElement(int level) const {
+    return this->neighbors_[level].next;
+  }
+  using parallel_skip_list::ElementBase<Element>::GetNextElement;
+
+  // Sums over a level of the list: the sum of the values of the elements, and
+  // the number of marked elements.
+  struct Sums {
+    int64_t value;
+    int64_t num_marked;
+  };
 
+  // Sums are only kept for forests with subtree aggregates enabled. Enabling
+  // them gives the element value `value`, unmarks it, and treats it as a
+  // singleton list, so an element already in a longer list needs a
+  // `BatchUpdateSums` afterwards.
+  void EnableSums(int64_t value);
+  void DisableSums();
+
+  // Updates the sums of the ancestors of each non-null `elements[i]`, where the
+  // ancestors of v are as described for `AugmentedElement::BatchUpdate`. Call
+  // this on the last element before each place where the list changed, and on
+  // each element whose value or mark changed, once the list is done changing.
+  static void BatchUpdateSums(Element* const* elements, size_t len);
+  // Returns the sum of the values from `left` up to and including `right`. In a
+  // cyclic list, this wraps around from `left` until it reaches `right`.
+  static int64_t GetSubsequenceSum(const Element* left, const Element* right);
+  // Returns the sum of the values over the whole list, which must be cyclic.
+  int64_t GetSum() const;
+  // Appends the marked elements of the list, which must be cyclic, to `out` in
+  // list order starting from the representative, stopping once `out` holds
+  // `limit` elements. Only parts of the list with marked elements are visited,
+  // which takes O(k log n) expected work to find k elements.
+  void FindMarked(size_t limit, parlay::sequence<Element*>* out) const;
+
+  // While updating sums, this marks the lowest level at which `sums_` needs to
+  // be recomputed. This is declared first so that it fits in the padding at
+  // the end of the base class.
+  int update_level_{kNoUpdate};
   // If this element represents edge (u, v), `twin` should point towards (v, u).
   Element* twin_{nullptr};
   // When batch splitting, we mark this as `true` for an edge that we will
   // splice out in the current round of recursion.
   bool split_mark_{false};
+  // When batch splitting with `BatchCutOneRound`, a marked edge that is chosen
+  // as a ruler for contracting chains of marked edges stores its index into
+  // the ruler arrays here. While saving a forest, an edge (u, v) stores v here.
+  // Otherwise this is -1. (For 32-bit vertex IDs, this fits in the padding
+  // after `split_mark_`, so it does not grow the element.)
+  Vertex ruler_index_{-1};
+  // If sums are enabled, `sums_[0]` holds the value of this element and whether
+  // it is marked, and `sums_[i]` holds the sums over the elements from this one
+  // up to but excluding the next element on level i. Otherwise this is null.
+  Sums* sums_{nullptr};
 
  private:
   friend class parallel_skip_list::ElementBase<Element>;
   static void DerivedInitialize() {}
   static void DerivedFinish() {}
+
+  // Recomputes `sums_[1..level]` from the sums on the level below, first
+  // recomputing the descendants marked by `update_level_`.
+  void UpdateSumsTopDown(int level);
+  // Appends the marked elements from this element up to but excluding the next
+  // element on level `level` to `out`, stopping once `out` holds `limit`
+  // elements.
+  void FindMarkedBelow(int level, size_t limit,
+      parlay::sequence<Element*>* out) const;
 };
 
+template <typename Vertex>
+void Element<Vertex>::EnableSums(int64_t value) {
+  if (sums_ == nullptr) {
+    sums_ = new_array_no_init<Sums>(this->height_);
+  }
+  for (int i = 0; i < this->height_; i++) {
+    sums_[i] = Sums{value, 0};
+  }
+}
+
+template <typename Vertex>
+void Element<Vertex>::DisableSums() {
+  if (sums_ != nullptr) {
+    delete_array(sums_, this->height_);
+    sums_ = nullptr;
+  }
+}
+
+template <typename Vertex>
+void Element<Vertex>::UpdateSumsTopDown(int level) {
+  if (level == 0) {
+    if (this->height_ == 1) {
+      update_level_ = kNoUpdate;
+    }
+    return;
+  }
+  if (update_level_ < level) {
+    UpdateSumsTopDown(level - 1);
+  }
+  Sums sums{sums_[level - 1]};
+  Element* curr{this->neighbors_[level - 1].next};
+  while (curr != nullptr && curr->height_ < level + 1) {
+    if (curr->update_level_ != kNoUpdate && curr->update_level_ < level) {
+      curr->UpdateSumsTopDown(level - 1);
+    }
+    sums.value += curr->sums_[level - 1].value;
+    sums.num_marked += curr->sums_[level - 1].num_marked;
+    curr = curr->neighbors_[level - 1].next;
+  }
+  sums_[level] = sums;
+  if (this->height_ == level + 1) {
+    update_level_ = kNoUpdate;
+  }
+}
+
+// Same as `AugmentedElement::BatchUpdate` without new values: claim the
+// ancestors of the elements bottom-up, and then walk down from the topmost
+// claimed ancestors to recompute their sums.
+template <typename Vertex>
+void Element<Vertex>::BatchUpdateSums(Element* const* elements, size_t len) {
+  Element** top_elements{new_array_no_init<Element*>(len)};
+  parlay::parallel_for(0, len, [&](size_t i) {
+    top_elements[i] = nullptr;
+    int level{0};
+    Element* curr{elements[i]};
+    while (curr != nullptr) {
+      const int curr_update_level{curr->update_level_};
+      if (curr_update_level == kNoUpdate &&
+          CAS(&curr->update_level_, kNoUpdate, level)) {
+        level = curr->height_ - 1;
+        Element* parent{curr->FindLeftParent(level)};
+        if (parent == nullptr) {
+          top_elements[i] = curr;
+          break;
+        }
+        curr = parent;
+        level++;
+      } else {
+        // Another element shares this ancestor and has already claimed it.
+        if (curr_update_level > level) {
+          writeMin(&curr->update_level_, level);
+        }
+        break;
+      }
+    }
+  });
+  parlay::parallel_for(0, len, [&](size_t i) {
+    if (top_elements[i] != nullptr) {
+      top_elements[i]->UpdateSumsTopDown(top_elements[i]->height_ - 1);
+    }
+  });
+  delete_array(top_elements, len);
+}
+
+template <typename Vertex>
+int64_t Element<Vertex>::GetSubsequenceSum(
+    const Element* left, const Element* right) {
+  int64_t sum{right->sums_[0].value};
+  while (left != right) {
+    const int level{std::min(left->height_, right->height_) - 1};
+    if (level == left->height_ - 1) {
+      sum += left->sums_[level].value;
+      left = left->neighbors_[level].next;
+    } else {
+      right = right->neighbors_[level].prev;
+      sum += right->sums_[level].value;
+    }
+  }
+  return sum;
+}
+
+template <typename Vertex>
+int64_t Element<Vertex>::GetSum() const {
+  // The representative reaches the top level of the list, so on a cyclic list
+  // the top level runs around the whole list.
+  const Element* root{this->FindRepresentative()};
+  const int level{root->height_ - 1};
+  int64_t sum{root->sums_[level].value};
+  for (const Element* curr{root->neighbors_[level].next}; curr != root;
+       curr = curr->neighbors_[level].next) {
+    sum += curr->sums_[level].value;
+  }
+  return sum;
+}
+
+template <typename Vertex>
+void Element<Vertex>::FindMarkedBelow(int level, size_t limit,
+    parlay::sequence<Element*>* out) const {
+  if (level == 0) {
+    out->push_back(const_cast<Element*>(this));
+    return;
+  }
+  const Element* curr{this};
+  do {
+    if (curr->sums_[level - 1].num_marked > 0) {
+      curr->FindMarkedBelow(level - 1, limit, out);
+    }
+    curr = curr->neighbors_[level - 1].next;
+  } while (out->size() < limit && curr->height_ < level + 1);
+}
+
+template <typename Vertex>
+void Element<Vertex>::FindMarked(
+    size_t limit, parlay::sequence<Element*>* out) const {
+  if (out->size() >= limit) {
+    return;
+  }
+  const Element* root{this->FindRepresentative()};
+  const int level{root->height_ - 1};
+  const Element* curr{root};
+  do {
+    if (curr->sums_[level].num_marked > 0) {
+      curr->FindMarkedBelow(level, limit, out);
+    }
+    curr = curr->neighbors_[level].next;
+  } while (out->size() < limit && curr != root);
+}
+
 }  // namespace _internal
 
 }  // namespace parallel_euler_tour_tree
@@ -10,74 +10,640 @@
 // sequences.
 #include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <tuple>
 #include <utility>
 
-#include <sequence/parallel_skip_list/include/skip_list_base.hpp>
-#include <utilities/include/blockRadixSort.h>
-#include <utilities/include/list_allocator.h>
-#include <utilities/include/seq.h>
-#include <utilities/include/sequence_ops.h>
-#include <utilities/include/utils.h>
+#include <parlay/alloc.h>
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+#include <dynamic_trees/parallel_euler_tour_tree/include/sequence_policies.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/src/batch_tour_updates.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/src/union_find.hpp>
+#include <parlay/slice.h>
+#include <psl/utils.h>
+#include <utilities/include/hash_pair.hpp>
 
 namespace parallel_euler_tour_tree {
 
-using Element = _internal::Element;
-using std::pair;
+using _internal::Element;
 
 namespace {
 
-  // On BatchCut, randomly ignore 1/`kBatchCutRecursiveFactor` cuts and recurse
-  // on them later.
-  constexpr int kBatchCutRecursiveFactor{100};
+  // On BatchCutOneRound, sample 1/`kRulerSamplingFactor` of the cut edge
+  // elements as rulers for contracting chains of cut edges.
+  constexpr int kRulerSamplingFactor{16};
+
+  // Length of the header of the format written by `BasicEulerTourTree::Save`.
+  constexpr size_t kForestFileHeaderLength{32};
 
-  // Note: we never call `finish()` on this.
-  list_allocator<_internal::Element> allocator{};
+  void FailOnFile(const std::string& message, const std::string& filename) {
+    std::cerr << message << ": " << filename << std::endl;
+    exit(1);
+  }
 
-  void BatchCutSequential(EulerTourTree* ett, pair<int, int>* cuts, int len) {
-    for (int i = 0; i < len; i++) {
+  template <typename Vertex>
+  const char* ForestFileMagic() {
+    return sizeof(Vertex) == 4 ? kForestFileMagic : kForestFileMagic64;
+  }
+
+  template <typename Vertex>
+  using TourUpdates = _internal::BatchTourUpdates<BasicEulerTourTree<Vertex>,
+      BasicSkipListSequence<Element<Vertex>>>;
+
+  template <typename Vertex>
+  void BatchCutSequential(BasicEulerTourTree<Vertex>* ett,
+      std::pair<Vertex, Vertex>* cuts, Vertex len) {
+    for (Vertex i = 0; i < len; i++) {
       ett->Cut(cuts[i].first, cuts[i].second);
     }
   }
 
-  void BatchLinkSequential(EulerTourTree* ett, pair<int, int>* links, int len) {
-    for (int i = 0; i < len; i++) {
+  template <typename Vertex>
+  void BatchLinkSequential(BasicEulerTourTree<Vertex>* ett,
+      std::pair<Vertex, Vertex>* links, Vertex len) {
+    for (Vertex i = 0; i < len; i++) {
       ett->Link(links[i].first, links[i].second);
     }
   }
 
+  // In `BatchCutOneRound`, index 2i refers to the element of edge `cuts[i]` and
+  // index 2i + 1 refers to its twin.
+  template <typename Vertex>
+  Element<Vertex>* GetCutElement(Element<Vertex>** edge_elements, size_t i) {
+    Element<Vertex>* uv{edge_elements[i / 2]};
+    return i % 2 == 0 ? uv : uv->twin_;
+  }
+
+  // If `e` is (x, y) and is to be cut, then (y, x).next is the next place we
+  // could join to.
+  template <typename Vertex>
+  Element<Vertex>* GetNextJoinCandidate(const Element<Vertex>* e) {
+    return e->twin_->GetNextElement();
+  }
+
+
 }  // namespace
 
-EulerTourTree::EulerTourTree(int num_vertices)
-    : num_vertices_{num_vertices} , edges_{num_vertices_} , randomness_{} {
-  allocator.init();
-  Element::Initialize();
-  vertices_ = pbbs::new_array_no_init<Element>(num_vertices_);
-  parallel_for (int i = 0; i < num_vertices_; i++) {
-    new (&vertices_[i]) Element{randomness_.ith_rand(i)};
+template <typename Vertex>
+BasicEulerTourTree<Vertex>::BasicEulerTourTree(Vertex num_vertices)
+    : BasicEulerTourTree{
+          num_vertices, numa_placement::Policy::kFirstTouch} {}
+
+template <typename Vertex>
+BasicEulerTourTree<Vertex>::BasicEulerTourTree(
+    Vertex num_vertices, numa_placement::Policy numa_policy)
+    : num_vertices_{num_vertices}
+    , numa_policy_{numa_policy}
+    , vertices_per_node_{std::max<Vertex>(
+          (num_vertices + numa_placement::NumNodes() - 1) /
+              numa_placement::NumNodes(),
+          1)}
+    , vertices_{static_cast<size_t>(num_vertices)}
+    , edges_{num_vertices_, numa_policy}
+    , randomness_{} {
+  const int num_allocators{numa_policy == numa_placement::Policy::kPartitioned
+      ? numa_placement::NumNodes()
+      : 1};
+  for (int i = 0; i < num_allocators; i++) {
+    const numa_placement::Placement placement{numa_policy, i};
+    neighbor_allocators_.emplace_back(
+        new typename Element::NeighborAllocator{placement});
+    edge_allocators_.emplace_back(new concurrent_array_allocator::Pool{
+        sizeof(Element), alignof(Element), placement});
+  }
+  PlaceVertices(0, vertices_.Capacity());
+  parlay::parallel_for(0, num_vertices_, [&](size_t i) {
+    new (&vertices_[i]) Element{randomness_.ith_rand(i),
+        neighbor_allocators_[NodeOf(i)].get()};
     // The Euler tour on a vertex v (a singleton tree) is simply (v, v).
     Element::Join(&vertices_[i], &vertices_[i]);
+  });
+  randomness_ = randomness_.next();
+}
+
+template <typename Vertex>
+BasicEulerTourTree<Vertex>::~BasicEulerTourTree() {
+  SetRepresentativeCacheEnabled(false);
+  SetSnapshotsEnabled(false);
+  // Beyond its sums, an element only holds its neighbor array, which goes away
+  // with `neighbor_allocators_`, so the elements need not be destroyed.
+  SetSubtreeAggregatesEnabled(false);
+}
+
+template <typename Vertex>
+int BasicEulerTourTree<Vertex>::NodeOf(Vertex v) const {
+  return numa_policy_ == numa_placement::Policy::kPartitioned
+      ? (v / vertices_per_node_) % numa_placement::NumNodes()
+      : 0;
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::PlaceVertices(size_t begin, size_t end) {
+  if (numa_policy_ == numa_placement::Policy::kFirstTouch) {
+    return;
   }
+  vertices_.ForEachContiguousRange(begin, end,
+      [&](size_t first, Element* entries, size_t length) {
+    if (numa_policy_ == numa_placement::Policy::kInterleaved) {
+      numa_placement::Place(entries, length * sizeof(Element),
+          {numa_placement::Policy::kInterleaved});
+      return;
+    }
+    // Place the part of the run in each vertex range separately.
+    const size_t range_length{static_cast<size_t>(vertices_per_node_)};
+    for (size_t i = first; i < first + length;) {
+      const size_t range_end{
+          std::min((i / range_length + 1) * range_length, first + length)};
+      numa_placement::Place(entries + (i - first),
+          (range_end - i) * sizeof(Element),
+          {numa_placement::Policy::kPartitioned,
+           NodeOf(static_cast<Vertex>(i))});
+      i = range_end;
+    }
+  });
+}
+
+template <typename Vertex>
+Element<Vertex>* BasicEulerTourTree<Vertex>::NewEdgeElement(
+    size_t random_int, Vertex tail) {
+  const int node{NodeOf(tail)};
+  Element* element{new (edge_allocators_[node]->Allocate())
+      Element{random_int, neighbor_allocators_[node].get()}};
+  if (has_subtree_aggregates_) {
+    element->EnableSums(0);
+  }
+  return element;
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::DeleteEdgeElement(Element* element) {
+  element->~Element();
+  concurrent_array_allocator::Pool::Owner(element)->Free(element);
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::SetRepresentativeCacheEnabled(bool enabled) {
+  if (enabled && representative_cache_ == nullptr) {
+    representative_cache_ =
+        new _internal::ChunkedArray<CachedRepresentative>{
+            static_cast<size_t>(num_vertices_)};
+    parlay::parallel_for(0, num_vertices_, [&](size_t i) {
+      new (&(*representative_cache_)[i]) CachedRepresentative{{0}, {nullptr}};
+    });
+  } else if (!enabled && representative_cache_ != nullptr) {
+    delete representative_cache_;
+    representative_cache_ = nullptr;
+  }
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::AddVertices(Vertex k, Vertex* ids) {
+  UpdateScope update{this};
+  const Vertex num_reused{
+      std::min(k, static_cast<Vertex>(free_vertex_ids_.size()))};
+  for (Vertex i = 0; i < num_reused; i++) {
+    ids[i] = free_vertex_ids_.back();
+    free_vertex_ids_.pop_back();
+    if (has_subtree_aggregates_) {
+      vertices_[ids[i]].EnableSums(1);
+    }
+  }
+
+  const Vertex old_num_vertices{num_vertices_};
+  const Vertex num_new{k - num_reused};
+  const size_t old_capacity{vertices_.Capacity()};
+  vertices_.Reserve(old_num_vertices + num_new);
+  PlaceVertices(old_capacity, vertices_.Capacity());
+  parlay::parallel_for(0, num_new, [&](size_t i) {
+    const Vertex v{old_num_vertices + static_cast<Vertex>(i)};
+    ids[num_reused + i] = v;
+    new (&vertices_[v]) Element{randomness_.ith_rand(i),
+        neighbor_allocators_[NodeOf(v)].get()};
+    Element::Join(&vertices_[v], &vertices_[v]);
+    if (has_subtree_aggregates_) {
+      vertices_[v].EnableSums(1);
+    }
+  });
   randomness_ = randomness_.next();
+  if (representative_cache_ != nullptr) {
+    representative_cache_->Reserve(old_num_vertices + num_new);
+    parlay::parallel_for(0, num_new, [&](size_t i) {
+      new (&(*representative_cache_)[old_num_vertices + i])
+          CachedRepresentative{{0}, {nullptr}};
+    });
+  }
+  edges_.Reserve(old_num_vertices + num_new);
+  num_vertices_ = old_num_vertices + num_new;
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::RemoveIsolatedVertices(
+    const Vertex* ids, Vertex len) {
+  free_vertex_ids_.insert(free_vertex_ids_.end(), ids, ids + len);
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::WarmCache() const {
+  if (representative_cache_ != nullptr) {
+    parlay::parallel_for(0, num_vertices_, [&](size_t i) {
+      FindRepresentative(i);
+    });
+  }
+}
+
+template <typename Vertex>
+Element<Vertex>* BasicEulerTourTree<Vertex>::FindRepresentative(
+    Vertex v) const {
+  if (representative_cache_ == nullptr) {
+    return vertices_[v].FindRepresentative();
+  }
+  // Queries may fill in the same entry concurrently, but since the forest does
+  // not change between updates, they all write the same representative.
+  CachedRepresentative* entry{&(*representative_cache_)[v]};
+  if (entry->epoch.load(std::memory_order_acquire) == epoch_) {
+    return entry->representative.load(std::memory_order_relaxed);
+  }
+  Element* representative{vertices_[v].FindRepresentative()};
+  entry->representative.store(representative, std::memory_order_relaxed);
+  entry->epoch.store(epoch_, std::memory_order_release);
+  return representative;
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::SetSubtreeAggregatesEnabled(bool enabled) {
+  if (enabled == has_subtree_aggregates_) {
+    return;
+  }
+  has_subtree_aggregates_ = enabled;
+  const parlay::sequence<Element*> edge_elements{edges_.Elements()};
+  if (!enabled) {
+    parlay::parallel_for(0, num_vertices_, [&](size_t i) {
+      vertices_[i].DisableSums();
+    });
+    parlay::parallel_for(0, edge_elements.size(), [&](size_t i) {
+      edge_elements[i]->DisableSums();
+      edge_elements[i]->twin_->DisableSums();
+    });
+    return;
+  }
+
+  // Edge elements have value 0 so that sums over a tour only count vertices.
+  parlay::parallel_for(0, num_vertices_, [&](size_t i) {
+    vertices_[i].EnableSums(1);
+  });
+  parlay::parallel_for(0, edge_elements.size(), [&](size_t i) {
+    edge_elements[i]->EnableSums(0);
+    edge_elements[i]->twin_->EnableSums(0);
+  });
+  const size_t num_edges{edge_elements.size()};
+  const parlay::sequence<Element*> elements{parlay::tabulate(
+      num_vertices_ + 2 * num_edges, [&](size_t i) {
+        if (i < static_cast<size_t>(num_vertices_)) {
+          return &vertices_[i];
+        }
+        const size_t j{i - num_vertices_};
+        return j < num_edges ?
+            edge_elements[j] : edge_elements[j - num_edges]->twin_;
+      })};
+  UpdateSums(elements.data(), elements.size());
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::UpdateSums(
+    Element* const* elements, size_t len) {
+  if (has_subtree_aggregates_) {
+    Element::BatchUpdateSums(elements, len);
+  }
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchSetVertexValues(
+    const Vertex* vertices, const int64_t* values, Vertex len) {
+  const parlay::sequence<Element*> elements{parlay::tabulate(len,
+      [&](size_t i) {
+        Element* vertex{&vertices_[vertices[i]]};
+        vertex->sums_[0].value = values[i];
+        return vertex;
+      })};
+  UpdateSums(elements.data(), elements.size());
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchSetMark(
+    const Vertex* vertices, const bool* marks, Vertex len) {
+  const parlay::sequence<Element*> elements{parlay::tabulate(len,
+      [&](size_t i) {
+        Element* vertex{&vertices_[vertices[i]]};
+        vertex->sums_[0].num_marked = marks[i];
+        return vertex;
+      })};
+  UpdateSums(elements.data(), elements.size());
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::FindMarked(
+    Vertex v, Vertex limit, parlay::sequence<Vertex>* out) const {
+  parlay::sequence<Element*> marked;
+  vertices_[v].FindMarked(limit, &marked);
+  *out = parlay::map(marked, [&](const Element* e) {
+    return static_cast<Vertex>(vertices_.IndexOf(e));
+  });
+}
+
+template <typename Vertex>
+int64_t BasicEulerTourTree<Vertex>::SubtreeAggregate(
+    Vertex v, Vertex parent) const {
+  if (v == parent) {
+    return vertices_[v].GetSum();
+  }
+  const Element* parent_to_v{edges_.Find(parent, v)};
+  return Element::GetSubsequenceSum(parent_to_v, parent_to_v->twin_);
+}
+
+template <typename Vertex>
+int64_t* BasicEulerTourTree<Vertex>::BatchSubtreeAggregate(
+    Edge* queries, Vertex len) const {
+  int64_t* aggregates{new int64_t[len]};
+  parlay::parallel_for(0, len, [&](size_t i) {
+    aggregates[i] = SubtreeAggregate(queries[i].first, queries[i].second);
+  });
+  return aggregates;
+}
+
+template <typename Vertex>
+BasicEulerTourTree<Vertex>::UpdateScope::UpdateScope(BasicEulerTourTree* forest)
+    : forest_{forest} {
+  forest_->epoch_++;
+  forest_->update_depth_++;
+}
+
+template <typename Vertex>
+BasicEulerTourTree<Vertex>::UpdateScope::~UpdateScope() {
+  if (--forest_->update_depth_ == 0) {
+    forest_->PublishSnapshot();
+  }
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::SetSnapshotsEnabled(bool enabled) {
+  if (enabled && reader_slots_ == nullptr) {
+    reader_slots_ = new ReaderSlot[kMaxSnapshotReaders];
+    for (int i = 0; i < kMaxSnapshotReaders; i++) {
+      reader_slots_[i].in_use = false;
+      reader_slots_[i].snapshot = nullptr;
+    }
+    PublishSnapshot();
+  } else if (!enabled && reader_slots_ != nullptr) {
+    retired_snapshots_.push_back(snapshot_.exchange(nullptr));
+    for (const uintptr_t* snapshot : retired_snapshots_) {
+      delete_array(const_cast<uintptr_t*>(snapshot), num_vertices_);
+    }
+    retired_snapshots_.clear();
+    snapshot_touched_vertices_.clear();
+    delete[] reader_slots_;
+    reader_slots_ = nullptr;
+  }
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::TouchForSnapshot(
+    const Edge* edges, Vertex len) {
+  if (reader_slots_ == nullptr) {
+    return;
+  }
+  snapshot_touched_vertices_.push_back(parlay::tabulate(
+      2 * static_cast<size_t>(len), [&](size_t i) {
+        return i % 2 == 0 ? edges[i / 2].first : edges[i / 2].second;
+      }));
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::PublishSnapshot() {
+  if (reader_slots_ == nullptr) {
+    return;
+  }
+  uintptr_t* snapshot{new_array_no_init<uintptr_t>(num_vertices_)};
+  const uintptr_t* previous{snapshot_.load()};
+  if (previous == nullptr || rebuild_snapshot_) {
+    parlay::parallel_for(0, num_vertices_, [&](size_t i) {
+      snapshot[i] = reinterpret_cast<uintptr_t>(FindRepresentative(i));
+    });
+  } else {
+    // A tree that no update linked or cut keeps its tour, and hence its
+    // representative, so its entries carry over. Vertices added since the
+    // previous snapshot are isolated. The remaining trees are those containing
+    // a touched vertex, which are flattened once each.
+    parlay::parallel_for(0, snapshot_num_vertices_, [&](size_t i) {
+      snapshot[i] = previous[i];
+    });
+    parlay::parallel_for(snapshot_num_vertices_, num_vertices_, [&](size_t i) {
+      snapshot[i] = reinterpret_cast<uintptr_t>(FindRepresentative(i));
+    });
+    const parlay::sequence<Vertex> touched{
+        parlay::flatten(snapshot_touched_vertices_)};
+    parlay::sequence<std::pair<Element*, Vertex>> touched_trees{
+        parlay::tabulate(touched.size(), [&](size_t i) {
+          return std::make_pair(FindRepresentative(touched[i]), touched[i]);
+        })};
+    parlay::sort_inplace(touched_trees);
+    const parlay::sequence<std::pair<Element*, Vertex>> distinct_trees{
+        parlay::pack(touched_trees,
+            parlay::delayed_seq<bool>(touched_trees.size(), [&](size_t i) {
+              return i == 0 ||
+                  touched_trees[i].first != touched_trees[i - 1].first;
+            }))};
+    const parlay::sequence<Vertex> tree_vertices{parlay::map(distinct_trees,
+        [](const std::pair<Element*, Vertex>& tree) { return tree.second; })};
+    parlay::sequence<parlay::sequence<Vertex>> components;
+    BatchGetComponentVertices(
+        tree_vertices.data(), tree_vertices.size(), &components);
+    parlay::parallel_for(0, components.size(), [&](size_t i) {
+      const uintptr_t id{reinterpret_cast<uintptr_t>(distinct_trees[i].first)};
+      parlay::parallel_for(0, components[i].size(), [&](size_t j) {
+        snapshot[components[i][j]] = id;
+      });
+    });
+  }
+  snapshot_num_vertices_ = num_vertices_;
+  snapshot_touched_vertices_.clear();
+  rebuild_snapshot_ = false;
+  const uintptr_t* old_snapshot{snapshot_.exchange(snapshot)};
+  if (old_snapshot != nullptr) {
+    retired_snapshots_.push_back(old_snapshot);
+  }
+
+  // Free the retired snapshots that no reader holds. A reader that is about
+  // to hold one will see that `snapshot_` changed and let go of it again
+  // without reading it.
+  std::vector<const uintptr_t*> held_snapshots;
+  for (const uintptr_t* retired : retired_snapshots_) {
+    bool is_held{false};
+    for (int i = 0; i < kMaxSnapshotReaders; i++) {
+      is_held |= reader_slots_[i].snapshot.load() == retired;
+    }
+    if (is_held) {
+      held_snapshots.push_back(retired);
+    } else {
+      delete_array(const_cast<uintptr_t*>(retired), num_vertices_);
+    }
+  }
+  retired_snapshots_.swap(held_snapshots);
+}
+
+template <typename Vertex>
+BasicEulerTourTree<Vertex>::SnapshotReader::SnapshotReader(
+    const BasicEulerTourTree* forest)
+    : forest_{forest}, slot_{-1} {
+  for (int i = 0; i < kMaxSnapshotReaders && slot_ == -1; i++) {
+    bool in_use{false};
+    if (forest_->reader_slots_[i].in_use.compare_exchange_strong(
+            in_use, true)) {
+      slot_ = i;
+    }
+  }
+  if (slot_ == -1) {
+    std::cerr << "SnapshotReader: more than " << kMaxSnapshotReaders
+              << " readers" << std::endl;
+    std::abort();
+  }
+}
+
+template <typename Vertex>
+BasicEulerTourTree<Vertex>::SnapshotReader::~SnapshotReader() {
+  forest_->reader_slots_[slot_].in_use.store(false, std::memory_order_release);
+}
+
+template <typename Vertex>
+const uintptr_t* BasicEulerTourTree<Vertex>::SnapshotReader::Acquire() {
+  std::atomic<const uintptr_t*>& held{forest_->reader_slots_[slot_].snapshot};
+  const uintptr_t* snapshot{forest_->snapshot_.load()};
+  while (true) {
+    held.store(snapshot);
+    // If the snapshot is still the latest after we announced that we hold it,
+    // then the forest will see our announcement before it can free it.
+    const uintptr_t* latest{forest_->snapshot_.load()};
+    if (latest == snapshot) {
+      return snapshot;
+    }
+    snapshot = latest;
+  }
 }
 
-EulerTourTree::~EulerTourTree() {
-  pbbs::delete_array(vertices_, num_vertices_);
-  edges_.FreeElements(&allocator);
-  Element::Finish();
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::SnapshotReader::Release() {
+  forest_->reader_slots_[slot_].snapshot.store(
+      nullptr, std::memory_order_release);
 }
 
-bool EulerTourTree::IsConnected(int u, int v) const {
-  return vertices_[u].FindRepresentative() == vertices_[v].FindRepresentative();
+template <typename Vertex>
+bool BasicEulerTourTree<Vertex>::SnapshotReader::IsConnected(Vertex u, Vertex v) {
+  const uintptr_t* snapshot{Acquire()};
+  const bool connected{snapshot[u] == snapshot[v]};
+  Release();
+  return connected;
 }
 
-void EulerTourTree::Link(int u, int v) {
-  Element* uv{allocator.alloc()};
-  new (uv) Element{randomness_.ith_rand(0)};
-  Element* vu = allocator.alloc();
-  new (vu) Element{randomness_.ith_rand(1)};
+template <typename Vertex>
+bool* BasicEulerTourTree<Vertex>::SnapshotReader::BatchConnected(
+    Edge* queries, Vertex len) {
+  bool* connected{new bool[len]};
+  const uintptr_t* snapshot{Acquire()};
+  parlay::parallel_for(0, len, [&](size_t i) {
+    connected[i] = snapshot[queries[i].first] == snapshot[queries[i].second];
+  });
+  Release();
+  return connected;
+}
+
+template <typename Vertex>
+bool BasicEulerTourTree<Vertex>::IsConnected(Vertex u, Vertex v) const {
+  return FindRepresentative(u) == FindRepresentative(v);
+}
+
+template <typename Vertex>
+bool* BasicEulerTourTree<Vertex>::BatchConnected(Edge* queries, Vertex len) const {
+  bool* connected{new bool[len]};
+  parlay::parallel_for(0, len, [&](size_t i) {
+    connected[i] = IsConnected(queries[i].first, queries[i].second);
+  });
+  return connected;
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::GetComponentVertices(
+    Vertex v, parlay::sequence<Vertex>* out) const {
+  parlay::sequence<parlay::sequence<Vertex>> components;
+  BatchGetComponentVertices(&v, 1, &components);
+  *out = std::move(components[0]);
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchGetComponentVertices(
+    const Vertex* vertices, Vertex len,
+    parlay::sequence<parlay::sequence<Vertex>>* out) const {
+  // Group the queries by tree, and flatten the tour of the first query in
+  // each group.
+  parlay::sequence<std::pair<Element*, Vertex>> queries{parlay::tabulate(len,
+      [&](size_t i) {
+        return std::make_pair(FindRepresentative(vertices[i]),
+            static_cast<Vertex>(i));
+      })};
+  parlay::sort_inplace(queries);
+  const parlay::sequence<Vertex> leaders{parlay::pack_index<Vertex>(
+      parlay::delayed_seq<bool>(len, [&](size_t i) {
+        return i == 0 || queries[i].first != queries[i - 1].first;
+      }))};
+  const size_t num_tours{leaders.size()};
+  parlay::sequence<parlay::sequence<Vertex>> tour_vertices(num_tours);
+  parlay::parallel_for(0, num_tours, [&](size_t i) {
+    // Vertex elements are the ones without twins.
+    const parlay::sequence<Element*> vertex_elements{parlay::filter(
+        Element::Flatten(queries[leaders[i]].first),
+        [](const Element* e) { return e->twin_ == nullptr; })};
+    tour_vertices[i] = parlay::map(vertex_elements, [&](const Element* e) {
+      return static_cast<Vertex>(vertices_.IndexOf(e));
+    });
+  });
+
+  *out = parlay::sequence<parlay::sequence<Vertex>>(len);
+  parlay::parallel_for(0, num_tours, [&](size_t i) {
+    const size_t group_end{
+        i + 1 == num_tours ? static_cast<size_t>(len) : leaders[i + 1]};
+    parlay::parallel_for(leaders[i], group_end, [&](size_t j) {
+      (*out)[queries[j].second] = tour_vertices[i];
+    });
+  });
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchGetComponentIds(
+    const Vertex* vertices, Vertex len, uintptr_t* ids) const {
+  parlay::parallel_for(0, len, [&](size_t i) {
+    ids[i] = reinterpret_cast<uintptr_t>(FindRepresentative(vertices[i]));
+  });
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::Link(Vertex u, Vertex v) {
+  UpdateScope update{this};
+  const Edge link{u, v};
+  TouchForSnapshot(&link, 1);
+  Element* uv{NewEdgeElement(randomness_.ith_rand(0), u)};
+  Element* vu{NewEdgeElement(randomness_.ith_rand(1), v)};
   randomness_ = randomness_.next();
   uv->twin_ = vu;
   vu->twin_ = uv;
+  edges_.PrepareInsertions(1);
   edges_.Insert(u, v, uv);
   Element* u_left{&vertices_[u]};
   Element* v_left{&vertices_[v]};
@@ -87,79 +653,88 @@ void EulerTourTree::Link(int u, int v) {
   Element::Join(uv, v_right);
   Element::Join(v_left, vu);
   Element::Join(vu, u_right);
+  Element* const join_lefts[]{u_left, uv, v_left, vu};
+  UpdateSums(join_lefts, 4);
 }
 
-void EulerTourTree::BatchLink(pair<int, int>* links, int len) {
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchLink(Edge* links, Vertex len) {
+  UpdateScope update{this};
+  TouchForSnapshot(links, len);
   if (len <= 75) {
     BatchLinkSequential(this, links, len);
     return;
   }
 
-  // For each added edge {x, y}, allocate elements (x, y) and (y, x).
-  // For each vertex x that shows up in an added edge, split on (x, x). Let
-  // succ(x) denote the successor of (x, x) prior to splitting.
-  // For each vertex x, identify which y_1, y_2, ... y_k that x will be newly
-  // connected to by performing a semisort on {(x, y), (y, x) : {x, y} is an
-  // added edge}.
-  // If x has new neighbors y_1, y_2, ..., y_k, join (x, x) to (x, y_1). Join
-  // (y_i,x) to (x, y_{i+1}) for each i < k. Join (y_k, x) to succ(x).
-
-  pair<int, int>* links_both_dirs{
-      pbbs::new_array_no_init<pair<int, int>>(2 * len)};
-  parallel_for (int i = 0; i < len; i++) {
-    links_both_dirs[2 * i] = links[i];
-    links_both_dirs[2 * i + 1] = make_pair(links[i].second, links[i].first);
-  }
-  intSort::iSort(
-      links_both_dirs, 2 * len, num_vertices_ + 1, firstF<int, int>());
-
-  Element** split_successors{pbbs::new_array_no_init<Element*>(2 * len)};
-  parallel_for (uint64_t i = 0; i < 2 * len; i++) {
-    int u, v;
-    std::tie(u, v) = links_both_dirs[i];
-
-    // split on each vertex that appears in the input
-    if (i == 2 * len - 1 || u != links_both_dirs[i + 1].first) {
-      split_successors[i] = vertices_[u].Split();
-    }
+  perf_counters::PhaseCounter phases{"EulerTourTree::BatchLink"};
+  TourUpdates<Vertex>::BatchLink(this, links, len, &phases);
+  phases.Stop();
+}
 
-    // allocate edge element
-    if (u < v) {
-      Element* uv{allocator.alloc()};
-      new (uv) Element{randomness_.ith_rand(2 * i)};
-      Element* vu{allocator.alloc()};
-      new (vu) Element{randomness_.ith_rand(2 * i + 1)};
-      uv->twin_ = vu;
-      vu->twin_ = uv;
-      edges_.Insert(u, v, uv);
-    }
-  }
-  randomness_ = randomness_.next();
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchInsertEdgesFiltered(
+    Edge* edges, Vertex len, bool* accepted_out) {
+  UpdateScope update{this};
+  // Number the tours that the endpoints lie in by their representatives, and
+  // pick a spanning forest of the graph with those tours as vertices.
+  const parlay::sequence<Element*> representatives{parlay::tabulate(
+      2 * static_cast<size_t>(len), [&](size_t i) {
+        return FindRepresentative(
+            i % 2 == 0 ? edges[i / 2].first : edges[i / 2].second);
+      })};
+  const parlay::sequence<Element*> sorted{parlay::sort(representatives)};
+  const parlay::sequence<Element*> distinct{parlay::pack(sorted,
+      parlay::delayed_seq<bool>(sorted.size(), [&](size_t i) {
+        return i == 0 || sorted[i] != sorted[i - 1];
+      }))};
+  const auto tour_index{[&](size_t i) {
+    return std::lower_bound(distinct.begin(), distinct.end(),
+        representatives[i]) - distinct.begin();
+  }};
+  _internal::UnionFind tours{distinct.size()};
+  parlay::parallel_for(0, len, [&](size_t i) {
+    accepted_out[i] = tours.Unite(tour_index(2 * i), tour_index(2 * i + 1));
+  });
 
-  parallel_for (int i = 0; i < 2 * len; i++) {
-    int u, v;
-    std::tie(u, v) = links_both_dirs[i];
-    Element* uv{edges_.Find(u, v)};
-    Element* vu{uv->twin_};
-    if (i == 0 ||
-        u != links_both_dirs[i - 1].first) {
-      Element::Join(&vertices_[u], uv);
-    }
-    if (i == 2 * len - 1 ||
-        u != links_both_dirs[i + 1].first) {
-      Element::Join(vu, split_successors[i]);
-    } else {
-      int u2, v2;
-      std::tie(u2, v2) = links_both_dirs[i + 1];
-      Element::Join(vu, edges_.Find(u2, v2));
-    }
-  }
+  parlay::sequence<Edge> links{parlay::pack(
+      parlay::make_slice(edges, edges + len),
+      parlay::make_slice(accepted_out, accepted_out + len))};
+  BatchLink(links.data(), links.size());
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchCutFiltered(
+    Edge* cuts, Vertex len, bool* applied_out) {
+  UpdateScope update{this};
+  // Find the first position of each edge, with both orientations made the
+  // same, by reducing the positions by edge with a hash-based semisort.
+  const parlay::sequence<std::pair<Edge, size_t>> first_positions{
+      parlay::reduce_by_key(
+          parlay::tabulate(len, [&](size_t i) {
+            return std::make_pair(static_cast<Edge>(std::minmax(
+                cuts[i].first, cuts[i].second)), i);
+          }),
+          parlay::minimum<size_t>(), HashIntPairStruct{})};
+  parlay::parallel_for(0, len, [&](size_t i) {
+    applied_out[i] = false;
+  });
+  parlay::parallel_for(0, first_positions.size(), [&](size_t i) {
+    const Edge& edge{first_positions[i].first};
+    applied_out[first_positions[i].second] =
+        edges_.Find(edge.first, edge.second) != nullptr;
+  });
 
-  pbbs::delete_array(links_both_dirs, 2 * len);
-  pbbs::delete_array(split_successors, 2 * len);
+  parlay::sequence<Edge> applied_cuts{parlay::pack(
+      parlay::make_slice(cuts, cuts + len),
+      parlay::make_slice(applied_out, applied_out + len))};
+  BatchCut(applied_cuts.data(), applied_cuts.size());
 }
 
-void EulerTourTree::Cut(int u, int v) {
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::Cut(Vertex u, Vertex v) {
+  UpdateScope update{this};
+  const Edge cut{u, v};
+  TouchForSnapshot(&cut, 1);
   Element* uv{edges_.Find(u, v)};
   Element* vu{uv->twin_};
   edges_.Delete(u, v);
@@ -169,154 +744,417 @@ void EulerTourTree::Cut(int u, int v) {
   Element* u_right{vu->Split()};
   u_left->Split();
   v_left->Split();
-  uv->~Element();
-  allocator.free(uv);
-  vu->~Element();
-  allocator.free(vu);
+  DeleteEdgeElement(uv);
+  DeleteEdgeElement(vu);
   Element::Join(u_left, u_right);
   Element::Join(v_left, v_right);
+  Element* const join_lefts[]{u_left, v_left};
+  UpdateSums(join_lefts, 2);
 }
 
-// `ignored`, `join_targets`, and `edge_elements` are scratch space.
-// `ignored[i]` will be set to true if `cuts[i]` will not be executed in this
-// round of recursion.
-// `join_targets` stores sequence elements that need to be joined to each other.
-// `edge_elements[i]` stores a pointer to the sequence element corresponding to
-// edge `cuts[i]`.
-void EulerTourTree::BatchCutRecurse(pair<int, int>* cuts, int len,
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::AfterJoins(
+    const std::pair<Element*, Element*>* joins, size_t len,
+    perf_counters::PhaseCounter* phases) {
+  if (has_subtree_aggregates_) {
+    phases->Start("update sums");
+    const parlay::sequence<Element*> join_lefts{parlay::tabulate(len,
+        [&](size_t i) { return joins[i].first; })};
+    UpdateSums(join_lefts.data(), join_lefts.size());
+  }
+}
+
+// `ignored`, `join_targets`, and `edge_elements` are scratch space for
+// `BatchTourUpdates::BatchCutRound`, which sets `ignored[i]` to true if
+// `cuts[i]` will not be executed in this round of recursion.
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchCutRecurse(Edge* cuts, Vertex len,
     bool* ignored, Element** join_targets, Element** edge_elements) {
   if (len <= 75) {
     BatchCutSequential(this, cuts, len);
     return;
   }
 
-  // Notation: "(x, y).next" is the next element in the tour (x, y) is in. "(x,
-  // y).prev" is the previous element. "(x, y).twin" is (y, x).
-  // For each edge {x, y} to cut:
-  // Sequentially, we'd want to join (y, x).prev to (x, y).next and (x, y).prev
-  // to (y, x).next. We can't correctly do this if any of those four elements
-  // are to be cut and removed as well. Instead, for dealing with connecting (y,
-  // x).prev to (x, y).next (dealing with connecting (x, y).prev to (y,x ).next
-  // is symmetric), we do the following:
-  // - If (y, x).prev is to be cut, then do nothing --- some other thread will
-  // deal with this.
-  // - Otherwise, start with element e = (x, y).next. So long as e is to be cut,
-  // traverse to the next possible join location at e := e.next.twin. Join
-  // (y,x).prev to e.
-  // This strategy doesn't have good depth since we may have to traverse on e
-  // for a long time. To fix this, we randomly ignore some cuts so that all
-  // traversal lengths are O(log n) with high probability. We perform all
-  // unignored cuts as described above, and recurse on the ignored cuts
-  // afterwards.
-
-  parallel_for (int i = 0; i < len; i++) {
-    ignored[i] = randomness_.ith_rand(i) % kBatchCutRecursiveFactor == 0;
-
-    if (!ignored[i]) {
-      int u, v;
-      std::tie(u, v) = cuts[i];
-      Element* uv{edges_.Find(u, v)};
-      edge_elements[i] = uv;
-      Element* vu{uv->twin_};
-      uv->split_mark_ = vu->split_mark_ = true;
-    }
+  perf_counters::PhaseCounter phases{"EulerTourTree::BatchCut"};
+  TourUpdates<Vertex>::BatchCutRound(this, cuts, len, ignored, join_targets,
+      edge_elements, &phases);
+  phases.Stop();
+
+  parlay::sequence<Edge> next_cuts{parlay::pack(
+      parlay::make_slice(cuts, cuts + len),
+      parlay::make_slice(ignored, ignored + len))};
+  BatchCutRecurse(next_cuts.data(), next_cuts.size(),
+      ignored, join_targets, edge_elements);
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchCut(Edge* cuts, Vertex len) {
+  UpdateScope update{this};
+  TouchForSnapshot(cuts, len);
+  if (len <= 75) {
+    BatchCutSequential(this, cuts, len);
+    return;
   }
-  randomness_ = randomness_.next();
+  bool* ignored{new_array_no_init<bool>(len)};
+  Element** join_targets{new_array_no_init<Element*>(4 * static_cast<size_t>(len))};
+  Element** edge_elements{new_array_no_init<Element*>(len)};
+  BatchCutRecurse(cuts, len, ignored, join_targets, edge_elements);
+  delete_array(edge_elements, len);
+  delete_array(join_targets, 4 * static_cast<size_t>(len));
+  delete_array(ignored, len);
+}
 
-  parallel_for (int i = 0; i < len; i++) {
-    if (!ignored[i]) {
-      Element* uv{edge_elements[i]};
-      Element* vu{uv->twin_};
+// Fills `join_targets` for all `len` cuts at once. `edge_elements` must already
+// hold the elements of the cuts, and these elements and their twins must
+// already be marked with `split_mark_`.
+//
+// In `BatchCutRecurse`, each join starts from some cut element e whose
+// predecessor is not cut (call such an element a head) and walks e :=
+// e.twin.next until it reaches an uncut element. These walks follow disjoint
+// chains of cut elements. (A chain rotates through the out-edges (x, *) of a
+// vertex x and ends no later than the loop element (x, x), which is never cut.)
+// The total work of the walks is linear, but a single chain may be long.
+//
+// Instead, we additionally sample a random subset of cut elements as rulers.
+// Every head is a ruler as well. Each ruler walks only until it reaches another
+// ruler or an uncut element, which takes O(`kRulerSamplingFactor` log k) steps
+// with high probability. Then we pointer jump over the rulers to find the end
+// of each chain. Each sampled ruler is reached by at most one other ruler, so
+// only O(k / `kRulerSamplingFactor`) rulers take part in pointer jumping, which
+// takes O(log k) rounds.
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::FindJoinTargetsOneRound(Vertex len,
+    Element** join_targets, Element** edge_elements) {
+  const size_t num_elements{2 * static_cast<size_t>(len)};
+  bool* is_ruler{new_array_no_init<bool>(num_elements)};
+  parlay::parallel_for(0, num_elements, [&](size_t i) {
+    Element* e{GetCutElement(edge_elements, i)};
+    is_ruler[i] = !e->GetPreviousElement()->split_mark_ ||
+      randomness_.ith_rand(i) % kRulerSamplingFactor == 0;
+    if (is_ruler[i]) {
+      e->ruler_index_ = i;
+    }
+  });
+  randomness_ = randomness_.next();
 
-      Element* left_target{uv->GetPreviousElement()};
-      if (left_target->split_mark_) {
-        join_targets[4 * i] = nullptr;
-      } else {
-        Element* right_target{vu->GetNextElement()};
-        while (right_target->split_mark_) {
-          right_target = right_target->twin_->GetNextElement();
-        }
-        join_targets[4 * i] = left_target;
-        join_targets[4 * i + 1] = right_target;
+  // `next_ruler[i]` is the index of the next ruler on ruler i's chain, or -1 if
+  // the chain ends first. In the latter case, `chain_end[i]` is the uncut
+  // element that ends the chain.
+  Vertex* next_ruler{new_array_no_init<Vertex>(num_elements)};
+  Element** chain_end{new_array_no_init<Element*>(num_elements)};
+  bool* is_active{new_array_no_init<bool>(num_elements)};
+  parlay::parallel_for(0, num_elements, [&](size_t i) {
+    is_active[i] = false;
+    if (is_ruler[i]) {
+      Element* e{GetNextJoinCandidate(GetCutElement(edge_elements, i))};
+      while (e->split_mark_ && e->ruler_index_ == -1) {
+        e = GetNextJoinCandidate(e);
       }
-
-      left_target = vu->GetPreviousElement();
-      if (left_target->split_mark_) {
-        join_targets[4 * i + 2] = nullptr;
+      if (e->split_mark_) {
+        next_ruler[i] = e->ruler_index_;
+        is_active[i] = true;
       } else {
-        Element* right_target{uv->GetNextElement()};
-        while (right_target->split_mark_) {
-          right_target = right_target->twin_->GetNextElement();
-        }
-        join_targets[4 * i + 2] = left_target;
-        join_targets[4 * i + 3] = right_target;
+        next_ruler[i] = -1;
+        chain_end[i] = e;
       }
     }
+  });
+
+  parlay::sequence<Vertex> active{parlay::pack_index<Vertex>(
+      parlay::make_slice(is_active, is_active + num_elements))};
+  Vertex* new_next_ruler{new_array_no_init<Vertex>(num_elements)};
+  Element** new_chain_end{new_array_no_init<Element*>(num_elements)};
+  while (active.size() > 0) {
+    parlay::parallel_for(0, active.size(), [&](size_t j) {
+      const Vertex i{active[j]};
+      const Vertex next{next_ruler[i]};
+      new_next_ruler[i] = next_ruler[next];
+      new_chain_end[i] = chain_end[next];
+    });
+    parlay::parallel_for(0, active.size(), [&](size_t j) {
+      const Vertex i{active[j]};
+      next_ruler[i] = new_next_ruler[i];
+      chain_end[i] = new_chain_end[i];
+      is_active[j] = next_ruler[i] != -1;
+    });
+    active = parlay::pack(
+        active, parlay::make_slice(is_active, is_active + active.size()));
   }
 
-  parallel_for (int i = 0; i < len; i++) {
-    if (!ignored[i]) {
-      Element* uv{edge_elements[i]};
-      Element* vu{uv->twin_};
-      uv->Split();
-      vu->Split();
-      Element* predecessor{uv->GetPreviousElement()};
-      if (predecessor != nullptr) {
-        predecessor->Split();
-      }
-      predecessor = vu->GetPreviousElement();
-      if (predecessor != nullptr) {
-        predecessor->Split();
-      }
+  parlay::parallel_for(0, len, [&](size_t i) {
+    Element* uv{edge_elements[i]};
+    Element* vu{uv->twin_};
+
+    Element* left_target{uv->GetPreviousElement()};
+    if (left_target->split_mark_) {
+      join_targets[4 * i] = nullptr;
+    } else {
+      join_targets[4 * i] = left_target;
+      join_targets[4 * i + 1] = chain_end[2 * i];
     }
-  }
 
-  parallel_for (int i = 0; i < len; i++)  {
-    if (!ignored[i]) {
-      // Here we must use `edge_elements[i]` instead of `edges_.Find(u, v)`
-      // because the concurrent hash table cannot handle simultaneous lookups
-      // and deletions.
-      Element* uv{edge_elements[i]};
-      Element* vu{uv->twin_};
-      uv->~Element();
-      allocator.free(uv);
-      vu->~Element();
-      allocator.free(vu);
-      int u, v;
-      std::tie(u, v) = cuts[i];
-      edges_.Delete(u, v);
-
-      if (join_targets[4 * i] != nullptr) {
-        Element::Join(join_targets[4 * i], join_targets[4 * i + 1]);
-      }
-      if (join_targets[4 * i + 2] != nullptr) {
-        Element::Join(join_targets[4 * i + 2], join_targets[4 * i + 3]);
-      }
+    left_target = vu->GetPreviousElement();
+    if (left_target->split_mark_) {
+      join_targets[4 * i + 2] = nullptr;
+    } else {
+      join_targets[4 * i + 2] = left_target;
+      join_targets[4 * i + 3] = chain_end[2 * i + 1];
     }
-  }
+  });
 
-  seq::sequence<pair<int, int>> cuts_seq{
-      seq::sequence<pair<int, int>>(cuts, len)};
-  seq::sequence<bool> ignored_seq{seq::sequence<bool>(ignored, len)};
-  seq::sequence<pair<int, int>> next_cuts_seq{
-    pbbs::pack(cuts_seq, ignored_seq)};
-  BatchCutRecurse(next_cuts_seq.as_array(), next_cuts_seq.size(),
-      ignored, join_targets, edge_elements);
-  pbbs::delete_array(next_cuts_seq.as_array(), next_cuts_seq.size());
+  delete_array(new_chain_end, num_elements);
+  delete_array(new_next_ruler, num_elements);
+  delete_array(is_active, num_elements);
+  delete_array(chain_end, num_elements);
+  delete_array(next_ruler, num_elements);
+  delete_array(is_ruler, num_elements);
 }
 
-void EulerTourTree::BatchCut(pair<int, int>* cuts, int len) {
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::BatchCutOneRound(Edge* cuts, Vertex len) {
+  UpdateScope update{this};
+  TouchForSnapshot(cuts, len);
   if (len <= 75) {
     BatchCutSequential(this, cuts, len);
     return;
   }
-  bool* ignored{pbbs::new_array_no_init<bool>(len)};
-  Element** join_targets{pbbs::new_array_no_init<Element*>(4 * len)};
-  Element** edge_elements{pbbs::new_array_no_init<Element*>(len)};
-  BatchCutRecurse(cuts, len, ignored, join_targets, edge_elements);
-  pbbs::delete_array(edge_elements, len);
-  pbbs::delete_array(join_targets, 4 * len);
-  pbbs::delete_array(ignored, len);
+  Element** join_targets{new_array_no_init<Element*>(4 * static_cast<size_t>(len))};
+  Element** edge_elements{new_array_no_init<Element*>(len)};
+  perf_counters::PhaseCounter phases{"EulerTourTree::BatchCutOneRound"};
+  phases.Start("mark");
+  parlay::parallel_for(0, len, [&](size_t i) {
+    Vertex u, v;
+    std::tie(u, v) = cuts[i];
+    Element* uv{edges_.Find(u, v)};
+    edge_elements[i] = uv;
+    uv->split_mark_ = uv->twin_->split_mark_ = true;
+  });
+  phases.Start("find join targets");
+  FindJoinTargetsOneRound(len, join_targets, edge_elements);
+  TourUpdates<Vertex>::SpliceOutCuts(this, cuts, len, nullptr, join_targets,
+      edge_elements, &phases);
+  phases.Stop();
+  delete_array(edge_elements, len);
+  delete_array(join_targets, 4 * static_cast<size_t>(len));
+}
+
+template <typename Vertex>
+Vertex BasicEulerTourTree<Vertex>::ElementTarget(const Element* element) const {
+  const long long vertex{vertices_.IndexOf(element)};
+  return vertex != -1 ? vertex : element->ruler_index_;
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::Save(const std::string& filename) {
+  edges_.ParallelForEach([&](Vertex u, Vertex v, Element* uv) {
+    uv->ruler_index_ = v;
+    uv->twin_->ruler_index_ = u;
+  });
+
+  // Each tour with an edge is written starting from its representative (x, y),
+  // which is one of the tallest elements in the tour, and is found by vertex y.
+  bool* is_leader{new_array_no_init<bool>(num_vertices_)};
+  parlay::parallel_for(0, num_vertices_, [&](size_t v) {
+    const Element* vertex{&vertices_[v]};
+    is_leader[v] = vertex->GetNextElement() != vertex &&
+        ElementTarget(vertex->FindRepresentative()) == static_cast<Vertex>(v);
+  });
+  const parlay::sequence<Vertex> leaders{parlay::pack_index<Vertex>(
+      parlay::make_slice(is_leader, is_leader + num_vertices_))};
+  delete_array(is_leader, num_vertices_);
+  const size_t num_tours{leaders.size()};
+
+  parlay::sequence<parlay::sequence<Element*>> tours(num_tours);
+  parlay::sequence<uint64_t> offsets(num_tours + 1);
+  parlay::parallel_for(0, num_tours, [&](size_t i) {
+    tours[i] = Element::Flatten(&vertices_[leaders[i]]);
+    offsets[i] = tours[i].size();
+  });
+  offsets[num_tours] = 0;
+  const size_t num_entries{parlay::scan_inplace(offsets)};
+
+  const size_t file_length{kForestFileHeaderLength +
+      sizeof(uint64_t) * (num_tours + 1) + sizeof(Vertex) * num_entries};
+  const int fd{open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644)};
+  if (fd == -1) {
+    FailOnFile("Cannot open file", filename);
+  }
+  if (ftruncate(fd, file_length) == -1) {
+    FailOnFile("Cannot write file", filename);
+  }
+  char* file{static_cast<char*>(
+      mmap(nullptr, file_length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0))};
+  if (file == MAP_FAILED) {
+    FailOnFile("Cannot map file", filename);
+  }
+  close(fd);
+
+  const uint64_t header[3]{static_cast<uint64_t>(num_vertices_), num_tours,
+      num_entries};
+  memcpy(file, ForestFileMagic<Vertex>(), sizeof(kForestFileMagic));
+  memcpy(file + sizeof(kForestFileMagic), header, sizeof(header));
+  uint64_t* tour_offsets{
+      reinterpret_cast<uint64_t*>(file + kForestFileHeaderLength)};
+  Vertex* entries{reinterpret_cast<Vertex*>(tour_offsets + num_tours + 1)};
+  parlay::parallel_for(0, num_tours + 1, [&](size_t i) {
+    tour_offsets[i] = offsets[i];
+  });
+  parlay::parallel_for(0, num_tours, [&](size_t i) {
+    parlay::parallel_for(0, tours[i].size(), [&](size_t k) {
+      entries[offsets[i] + k] = ElementTarget(tours[i][k]);
+    });
+  });
+  if (munmap(file, file_length) == -1) {
+    FailOnFile("Cannot write file", filename);
+  }
+
+  edges_.ParallelForEach([&](Vertex, Vertex, Element* uv) {
+    uv->ruler_index_ = uv->twin_->ruler_index_ = -1;
+  });
+}
+
+template <typename Vertex>
+void BasicEulerTourTree<Vertex>::Load(const std::string& filename) {
+  UpdateScope update{this};
+  rebuild_snapshot_ = true;
+
+  const int fd{open(filename.c_str(), O_RDONLY)};
+  if (fd == -1) {
+    FailOnFile("Cannot open file", filename);
+  }
+  struct stat file_stats;
+  if (fstat(fd, &file_stats) == -1) {
+    FailOnFile("Cannot stat file", filename);
+  }
+  const size_t file_length = file_stats.st_size;
+  if (file_length < kForestFileHeaderLength) {
+    FailOnFile("Not a forest file", filename);
+  }
+  const char* file{static_cast<const char*>(
+      mmap(nullptr, file_length, PROT_READ, MAP_PRIVATE, fd, 0))};
+  if (file == MAP_FAILED) {
+    FailOnFile("Cannot map file", filename);
+  }
+  close(fd);
+
+  uint64_t header[3];
+  memcpy(header, file + sizeof(kForestFileMagic), sizeof(header));
+  const uint64_t num_tours{header[1]};
+  const uint64_t num_entries{header[2]};
+  if (memcmp(file, ForestFileMagic<Vertex>(), sizeof(kForestFileMagic)) != 0 ||
+      file_length != kForestFileHeaderLength +
+          sizeof(uint64_t) * (num_tours + 1) + sizeof(Vertex) * num_entries) {
+    FailOnFile("Not a forest file", filename);
+  }
+  if (header[0] != static_cast<uint64_t>(num_vertices_)) {
+    FailOnFile("Forest file has a different number of vertices", filename);
+  }
+  std::atomic<bool> has_edges{false};
+  parlay::parallel_for(0, num_vertices_, [&](size_t v) {
+    if (vertices_[v].GetNextElement() != &vertices_[v]) {
+      has_edges.store(true, std::memory_order_relaxed);
+    }
+  });
+  if (has_edges) {
+    FailOnFile("Cannot load into a forest with edges", filename);
+  }
+  // The forest has no edges, but its edge table may still hold tombstones of
+  // deleted edges.
+  edges_.Clear();
+
+  const uint64_t* tour_offsets{
+      reinterpret_cast<const uint64_t*>(file + kForestFileHeaderLength)};
+  const Vertex* entries{
+      reinterpret_cast<const Vertex*>(tour_offsets + num_tours + 1)};
+  std::atomic<bool> is_corrupt{tour_offsets[num_tours] != num_entries};
+  parlay::parallel_for(0, num_tours, [&](size_t i) {
+    if (tour_offsets[i] >= tour_offsets[i + 1]) {
+      is_corrupt.store(true, std::memory_order_relaxed);
+    }
+  });
+  parlay::parallel_for(0, num_entries, [&](size_t j) {
+    if (entries[j] < 0 || entries[j] >= num_vertices_) {
+      is_corrupt.store(true, std::memory_order_relaxed);
+    }
+  });
+  if (is_corrupt) {
+    FailOnFile("Corrupt forest file", filename);
+  }
+  // Calls `f(j, x, y, next_j)` for each entry j, where the entry stands for
+  // element (x, y) and is followed in its tour by entry `next_j`.
+  const auto for_each_entry{[&](auto f) {
+    parlay::parallel_for(0, num_tours, [&](size_t i) {
+      const uint64_t begin{tour_offsets[i]};
+      const uint64_t end{tour_offsets[i + 1]};
+      parlay::parallel_for(begin, end, [&](size_t j) {
+        f(j, entries[j == begin ? end - 1 : j - 1], entries[j],
+            j + 1 == end ? begin : j + 1);
+      });
+    });
+  }};
+
+  // Create the elements, splitting the vertices in tours out of their
+  // singleton tours. Then pair up twins, since `EdgeMap` insertions must not
+  // be mixed with lookups. Then join the elements into tours. Along the way,
+  // reject files that list an element more than once or an edge without its
+  // twin, before anything is joined.
+  Element** elements{new_array_no_init<Element*>(num_entries)};
+  // Each edge of a forest file is listed in both directions.
+  edges_.PrepareInsertions(num_entries / 2);
+  bool* is_listed{new_array_no_init<bool>(num_vertices_)};
+  parlay::parallel_for(0, num_vertices_, [&](size_t v) {
+    is_listed[v] = false;
+  });
+  for_each_entry([&](size_t j, Vertex x, Vertex y, size_t) {
+    if (x == y) {
+      elements[j] = &vertices_[x];
+      if (CAS(&is_listed[x], false, true)) {
+        vertices_[x].Split();
+      } else {
+        is_corrupt.store(true, std::memory_order_relaxed);
+      }
+    } else if (x < y) {
+      elements[j] = NewEdgeElement(randomness_.ith_rand(j), x);
+      if (!edges_.Insert(x, y, elements[j])) {
+        is_corrupt.store(true, std::memory_order_relaxed);
+      }
+    }
+  });
+  delete_array(is_listed, num_vertices_);
+  if (is_corrupt) {
+    FailOnFile("Corrupt forest file", filename);
+  }
+  for_each_entry([&](size_t j, Vertex x, Vertex y, size_t) {
+    if (x > y) {
+      elements[j] = NewEdgeElement(randomness_.ith_rand(j), x);
+      Element* twin{edges_.Find(y, x)};
+      if (twin == nullptr ||
+          !CAS(&twin->twin_, static_cast<Element*>(nullptr), elements[j])) {
+        is_corrupt.store(true, std::memory_order_relaxed);
+        return;
+      }
+      elements[j]->twin_ = twin;
+    }
+  });
+  for_each_entry([&](size_t j, Vertex x, Vertex y, size_t) {
+    if (x < y && elements[j]->twin_ == nullptr) {
+      is_corrupt.store(true, std::memory_order_relaxed);
+    }
+  });
+  if (is_corrupt) {
+    FailOnFile("Corrupt forest file", filename);
+  }
+  for_each_entry([&](size_t j, Vertex, Vertex, size_t next_j) {
+    Element::Join(elements[j], elements[next_j]);
+  });
+  randomness_ = randomness_.next();
+  UpdateSums(elements, num_entries);
+
+  delete_array(elements, num_entries);
+  munmap(const_cast<char*>(file), file_length);
 }
 
+template class BasicEulerTourTree<int32_t>;
+template class BasicEulerTourTree<int64_t>;
+
 }  // namespace parallel_euler_tour_tree
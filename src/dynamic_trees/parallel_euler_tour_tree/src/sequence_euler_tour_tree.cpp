@@ -0,0 +1,133 @@
+// See euler_tour_tree.cpp for how forests are represented by Euler tours and
+// batch_tour_updates.hpp for the batch link and batch cut algorithms, which are
+// shared with `EulerTourTree`.
+#include <dynamic_trees/parallel_euler_tour_tree/include/sequence_euler_tour_tree.hpp>
+
+#include <utility>
+
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+#include <parlay/slice.h>
+#include <psl/utils.h>
+
+namespace parallel_euler_tour_tree {
+
+template <typename Sequence>
+SequenceEulerTourTree<Sequence>::SequenceEulerTourTree(Vertex num_vertices)
+    : num_vertices_{num_vertices}
+    , edge_allocator_{sizeof(Element), alignof(Element)}
+    , vertices_{new_array_no_init<Element>(num_vertices)}
+    , edges_{num_vertices_}
+    , randomness_{} {
+  parlay::parallel_for(0, num_vertices_, [&](size_t i) {
+    Sequence::template Construct<Element>(
+        &vertices_[i], randomness_.ith_rand(i), &allocators_);
+    // The Euler tour on a vertex v (a singleton tree) is simply (v, v).
+    Sequence::MakeCycle(&vertices_[i]);
+  });
+  randomness_ = randomness_.next();
+}
+
+template <typename Sequence>
+SequenceEulerTourTree<Sequence>::~SequenceEulerTourTree() {
+  edges_.ParallelForEach([&](Vertex, Vertex, Element* uv) {
+    DeleteEdgeElement(uv->twin_);
+    DeleteEdgeElement(uv);
+  });
+  delete_array(vertices_, num_vertices_);
+}
+
+template <typename Sequence>
+typename SequenceEulerTourTree<Sequence>::Element*
+SequenceEulerTourTree<Sequence>::NewEdgeElement(size_t random_int, Vertex) {
+  return Sequence::template Construct<Element>(
+      edge_allocator_.Allocate(), random_int, &allocators_);
+}
+
+template <typename Sequence>
+void SequenceEulerTourTree<Sequence>::DeleteEdgeElement(Element* element) {
+  element->~Element();
+  edge_allocator_.Free(element);
+}
+
+template <typename Sequence>
+bool SequenceEulerTourTree<Sequence>::IsConnected(Vertex u, Vertex v) const {
+  return Sequence::FindRepresentative(&vertices_[u]) ==
+      Sequence::FindRepresentative(&vertices_[v]);
+}
+
+template <typename Sequence>
+bool* SequenceEulerTourTree<Sequence>::BatchConnected(
+    Edge* queries, Vertex len) const {
+  bool* connected{new bool[len]};
+  parlay::parallel_for(0, len, [&](size_t i) {
+    connected[i] = IsConnected(queries[i].first, queries[i].second);
+  });
+  return connected;
+}
+
+template <typename Sequence>
+void SequenceEulerTourTree<Sequence>::Link(Vertex u, Vertex v) {
+  Edge link{u, v};
+  BatchLink(&link, 1);
+}
+
+template <typename Sequence>
+void SequenceEulerTourTree<Sequence>::Cut(Vertex u, Vertex v) {
+  Edge cut{u, v};
+  BatchCut(&cut, 1);
+}
+
+template <typename Sequence>
+void SequenceEulerTourTree<Sequence>::BatchLink(Edge* links, Vertex len) {
+  if (len == 0) {
+    return;
+  }
+  perf_counters::PhaseCounter phases{"SequenceEulerTourTree::BatchLink"};
+  TourUpdates::BatchLink(this, links, len, &phases);
+  phases.Stop();
+}
+
+// `ignored`, `join_targets`, and `edge_elements` are scratch space for
+// `BatchTourUpdates::BatchCutRound`, which sets `ignored[i]` to true if
+// `cuts[i]` will not be executed in this round of recursion.
+template <typename Sequence>
+void SequenceEulerTourTree<Sequence>::BatchCutRecurse(Edge* cuts, Vertex len,
+    bool* ignored, Element** join_targets, Element** edge_elements) {
+  if (len == 0) {
+    return;
+  }
+
+  perf_counters::PhaseCounter phases{"SequenceEulerTourTree::BatchCut"};
+  TourUpdates::BatchCutRound(this, cuts, len, ignored, join_targets,
+      edge_elements, &phases);
+  phases.Stop();
+
+  parlay::sequence<Edge> next_cuts{parlay::pack(
+      parlay::make_slice(cuts, cuts + len),
+      parlay::make_slice(ignored, ignored + len))};
+  BatchCutRecurse(next_cuts.data(), next_cuts.size(),
+      ignored, join_targets, edge_elements);
+}
+
+template <typename Sequence>
+void SequenceEulerTourTree<Sequence>::BatchCut(Edge* cuts, Vertex len) {
+  if (len == 0) {
+    return;
+  }
+  bool* ignored{new_array_no_init<bool>(len)};
+  Element** join_targets{
+      new_array_no_init<Element*>(4 * static_cast<size_t>(len))};
+  Element** edge_elements{new_array_no_init<Element*>(len)};
+  BatchCutRecurse(cuts, len, ignored, join_targets, edge_elements);
+  delete_array(edge_elements, len);
+  delete_array(join_targets, 4 * static_cast<size_t>(len));
+  delete_array(ignored, len);
+}
+
+template class SequenceEulerTourTree<SkipListSequence>;
+template class SequenceEulerTourTree<AugmentedSkipListSequence>;
+template class SequenceEulerTourTree<TreapSequence>;
+
+}  // namespace parallel_euler_tour_tree
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+
+namespace parallel_euler_tour_tree {
+
+namespace _internal {
+
+// Element of an Euler tour kept in the sequence structure of `Sequence`, one of
+// the policies in sequence_policies.hpp.
+template <typename Sequence>
+class TourElement : public Sequence::Node {
+ public:
+  // Takes the constructor arguments of `Sequence::Node`. Use
+  // `Sequence::Construct` to construct one.
+  template <typename... Args>
+  explicit TourElement(size_t random_int, Args... args)
+      : Sequence::Node(random_int, args...) {}
+
+  // Steps around the tour, as for `Sequence::GetNext` and
+  // `Sequence::GetPrevious`.
+  TourElement* GetNextElement() const {
+    return static_cast<TourElement*>(Sequence::GetNext(this));
+  }
+  TourElement* GetPreviousElement() const {
+    return static_cast<TourElement*>(Sequence::GetPrevious(this));
+  }
+
+  // If this element represents edge (u, v), `twin` should point towards (v, u).
+  TourElement* twin_{nullptr};
+  // When batch splitting, we mark this as `true` for an edge that we will
+  // splice out in the current round of recursion.
+  bool split_mark_{false};
+};
+
+}  // namespace _internal
+
+}  // namespace parallel_euler_tour_tree
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <utility>
+
+#include <parlay/primitives.h>
+#include <parlay/sequence.h>
+#include <psl/utils.h>
+
+namespace parallel_euler_tour_tree {
+
+namespace _internal {
+
+// Union-find over the integers [0, n). `Unite` and `Find` may run concurrently
+// with each other.
+class UnionFind {
+ public:
+  explicit UnionFind(size_t n)
+      : parents_{parlay::tabulate(n, [](size_t i) { return i; })} {}
+
+  size_t Find(size_t x) {
+    // Path halving: point x at its grandparent while walking up.
+    while (true) {
+      const size_t parent{parents_[x]};
+      const size_t grandparent{parents_[parent]};
+      if (parent == grandparent) {
+        return parent;
+      }
+      CAS(&parents_[x], parent, grandparent);
+      x = grandparent;
+    }
+  }
+
+  // Merges the sets of `x` and `y`. Returns false if they were already the
+  // same set. The root with the larger index is hooked under the other root by
+  // CAS, retrying if it stopped being a root in the meantime, so each `Unite`
+  // that returns true merges two distinct sets.
+  bool Unite(size_t x, size_t y) {
+    while (true) {
+      x = Find(x);
+      y = Find(y);
+      if (x == y) {
+        return false;
+      }
+      if (x < y) {
+        std::swap(x, y);
+      }
+      if (CAS(&parents_[x], x, y)) {
+        return true;
+      }
+    }
+  }
+
+ private:
+  parlay::sequence<size_t> parents_;
+};
+
+}  // namespace _internal
+
+}  // namespace parallel_euler_tour_tree
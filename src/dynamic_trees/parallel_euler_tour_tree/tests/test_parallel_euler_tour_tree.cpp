@@ -1,15 +1,33 @@
 #include <dynamic_trees/parallel_euler_tour_tree/include/euler_tour_tree.hpp>
 #include <dynamic_trees/parallel_euler_tour_tree/tests/simple_forest_connectivity.hpp>
 
-#include <boost/functional/hash.hpp>
+#include <dynamic_trees/benchmarks/data/src/graph_io.hpp>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
 #include <random>
+#include <thread>
+#include <tuple>
+#include <unordered_set>
 #include <utility>
+#include <vector>
 
+#include <psl/numa_placement.hpp>
+#include <psl/utils.h>
 #include <utilities/include/debug.hpp>
 #include <utilities/include/hash_pair.hpp>
 
 using EulerTourTree = parallel_euler_tour_tree::EulerTourTree;
+using EulerTourTree64 = parallel_euler_tour_tree::EulerTourTree64;
 
 constexpr int num_vertices{500};
 constexpr int link_attempts_per_round{400};
@@ -26,7 +44,811 @@ void CheckAllPairsConnectivity(
   }
 }
 
-int main() {
+// Links and then cuts all edges of the forest in `graph_filename`, which may be
+// in any format accepted by `ReadEdgeList`.
+void CheckGraphFile(char* graph_filename) {
+  EdgeList graph{ReadEdgeList(graph_filename)};
+  EulerTourTree ett{graph.num_vertices};
+  ett.BatchLink(graph.edges, graph.num_edges);
+  for (int i = 0; i < graph.num_edges; i++) {
+    assert(ett.IsConnected(graph.edges[i].first, graph.edges[i].second));
+  }
+  {
+    const char filename[]{"test_parallel_euler_tour_tree_forest.bin"};
+    ett.Save(filename);
+    EulerTourTree loaded_ett{graph.num_vertices};
+    loaded_ett.Load(filename);
+    std::remove(filename);
+    for (int i = 0; i < graph.num_edges; i++) {
+      assert(loaded_ett.IsConnected(
+          graph.edges[i].first, graph.edges[i].second));
+    }
+    loaded_ett.BatchCut(graph.edges, graph.num_edges);
+  }
+  ett.BatchCut(graph.edges, graph.num_edges);
+  for (int i = 0; i < graph.num_edges; i++) {
+    assert(!ett.IsConnected(graph.edges[i].first, graph.edges[i].second));
+  }
+  FreeEdgeList(&graph);
+}
+
+// Checks that cached representatives are invalidated by updates: links a path
+// in batches with queries between them, then cuts it in batches.
+void CheckRepresentativeCache() {
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree ett{num_vertices};
+  ett.SetRepresentativeCacheEnabled(true);
+  constexpr int batch_size{100};
+  std::pair<int, int> path[num_vertices - 1];
+  for (int v = 0; v < num_vertices - 1; v++) {
+    path[v] = std::make_pair(v, v + 1);
+  }
+  for (int i = 0; i < num_vertices - 1; i += batch_size) {
+    const int len{std::min(batch_size, num_vertices - 1 - i)};
+    for (int j = i; j < i + len; j++) {
+      reference_solution.Link(path[j].first, path[j].second);
+    }
+    ett.BatchLink(path + i, len);
+    CheckAllPairsConnectivity(reference_solution, ett);
+  }
+  for (int i = 0; i < num_vertices - 1; i += batch_size) {
+    const int len{std::min(batch_size, num_vertices - 1 - i)};
+    for (int j = i; j < i + len; j++) {
+      reference_solution.Cut(path[j].first, path[j].second);
+    }
+    ett.BatchCut(path + i, len);
+    ett.WarmCache();
+    CheckAllPairsConnectivity(reference_solution, ett);
+  }
+}
+
+// Links a path in batches while another thread queries a `SnapshotReader`.
+// Every answer must agree with the forest from before or after the batch in
+// flight. Then cuts the path and checks the reader against the reference.
+void CheckSnapshotReader() {
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree ett{num_vertices};
+  ett.SetSnapshotsEnabled(true);
+  constexpr int batch_size{100};
+  std::pair<int, int> path[num_vertices - 1];
+  for (int v = 0; v < num_vertices - 1; v++) {
+    path[v] = std::make_pair(v, v + 1);
+  }
+
+  // Vertices 0, 1, ..., `linked_end` are connected after the batch in flight,
+  // and 0, 1, ..., `published_end` are connected before it.
+  std::atomic<int> linked_end{0}, published_end{0};
+  std::atomic<bool> done{false};
+  std::thread reader_thread{[&] {
+    EulerTourTree::SnapshotReader reader{&ett};
+    int v{0};
+    while (!done) {
+      v = (v + 1) % num_vertices;
+      const int lower{published_end};
+      const bool connected{reader.IsConnected(0, v)};
+      const int upper{linked_end};
+      assert(v > lower || connected);
+      assert(v <= upper || !connected);
+    }
+  }};
+  for (int i = 0; i < num_vertices - 1; i += batch_size) {
+    const int len{std::min(batch_size, num_vertices - 1 - i)};
+    linked_end = i + len;
+    ett.BatchLink(path + i, len);
+    published_end = i + len;
+  }
+  done = true;
+  reader_thread.join();
+
+  for (int v = 0; v < num_vertices - 1; v++) {
+    reference_solution.Link(path[v].first, path[v].second);
+  }
+  EulerTourTree::SnapshotReader reader{&ett};
+  for (int i = 0; i < num_vertices - 1; i += batch_size) {
+    const int len{std::min(batch_size, num_vertices - 1 - i)};
+    for (int j = i; j < i + len; j++) {
+      reference_solution.Cut(path[j].first, path[j].second);
+    }
+    ett.BatchCut(path + i, len);
+    for (int u = 0; u < num_vertices; u++) {
+      for (int v = 0; v < num_vertices; v++) {
+        assert(reference_solution.IsConnected(u, v) ==
+               reader.IsConnected(u, v));
+      }
+    }
+  }
+}
+
+// Mixes every kind of update with snapshots on and checks after each that a
+// `SnapshotReader` agrees with the forest on all pairs, since snapshots only
+// recompute the trees an update touched.
+void CheckSnapshotAfterMixedUpdates() {
+  std::mt19937 rng{};
+  rng.seed(7);
+  EulerTourTree ett{num_vertices};
+  ett.SetSnapshotsEnabled(true);
+  EulerTourTree::SnapshotReader reader{&ett};
+  int n{num_vertices};
+  const auto check_reader{[&] {
+    for (int u = 0; u < n; u++) {
+      for (int v = 0; v < n; v++) {
+        assert(reader.IsConnected(u, v) == ett.IsConnected(u, v));
+      }
+    }
+  }};
+  std::vector<std::pair<int, int>> forest_edges;
+  for (int round = 0; round < 4; round++) {
+    std::uniform_int_distribution<int> vert_dist{0, n - 1};
+    std::vector<std::pair<int, int>> edges;
+    for (int i = 0; i < n / 2; i++) {
+      edges.emplace_back(vert_dist(rng), vert_dist(rng));
+    }
+    bool* accepted{new bool[edges.size()]};
+    ett.BatchInsertEdgesFiltered(edges.data(), edges.size(), accepted);
+    for (size_t i = 0; i < edges.size(); i++) {
+      if (accepted[i]) {
+        forest_edges.push_back(edges[i]);
+      }
+    }
+    delete[] accepted;
+    check_reader();
+
+    std::shuffle(forest_edges.begin(), forest_edges.end(), rng);
+    const std::pair<int, int> single_cut{forest_edges.back()};
+    forest_edges.pop_back();
+    ett.Cut(single_cut.first, single_cut.second);
+    check_reader();
+    if (!ett.IsConnected(single_cut.first, 0)) {
+      ett.Link(single_cut.first, 0);
+      forest_edges.emplace_back(single_cut.first, 0);
+      check_reader();
+    }
+
+    const size_t num_cuts{forest_edges.size() / 3};
+    std::vector<std::pair<int, int>> cuts(
+        forest_edges.end() - num_cuts, forest_edges.end());
+    forest_edges.resize(forest_edges.size() - num_cuts);
+    if (round % 2 == 0) {
+      ett.BatchCut(cuts.data(), cuts.size());
+    } else {
+      ett.BatchCutOneRound(cuts.data(), cuts.size());
+    }
+    check_reader();
+
+    int ids[10];
+    ett.AddVertices(10, ids);
+    n += 10;
+    ett.Link(ids[0], 0);
+    forest_edges.emplace_back(ids[0], 0);
+    check_reader();
+  }
+}
+
+// Grows a small forest well past its initial size, links a path through the
+// old and new vertices, then cuts it, frees some IDs, and checks that adding
+// vertices reuses them.
+void CheckAddVertices() {
+  constexpr int initial_num_vertices{10};
+  constexpr int num_added{1000};
+  constexpr int total_num_vertices{initial_num_vertices + num_added};
+  EulerTourTree ett{initial_num_vertices};
+  ett.SetRepresentativeCacheEnabled(true);
+  std::vector<int> ids(num_added);
+  for (int i = 0; i < num_added; i += 100) {
+    ett.AddVertices(100, ids.data() + i);
+  }
+  for (int i = 0; i < num_added; i++) {
+    assert(ids[i] == initial_num_vertices + i);
+  }
+  assert(ett.NumVertexIds() == total_num_vertices);
+
+  std::vector<std::pair<int, int>> path;
+  for (int v = 0; v < total_num_vertices - 1; v++) {
+    path.emplace_back(v, v + 1);
+  }
+  ett.BatchLink(path.data(), path.size());
+  for (int v = 1; v < total_num_vertices; v++) {
+    assert(ett.IsConnected(0, v));
+  }
+  ett.BatchCut(path.data(), path.size());
+
+  const int removed[]{3, 700, 5};
+  ett.RemoveIsolatedVertices(removed, 3);
+  int reused[4];
+  ett.AddVertices(4, reused);
+  std::sort(reused, reused + 4);
+  assert(reused[0] == 3 && reused[1] == 5 && reused[2] == 700);
+  assert(reused[3] == total_num_vertices);
+  ett.Link(reused[0], reused[3]);
+  ett.Link(reused[2], reused[3]);
+  assert(ett.IsConnected(3, 700));
+  assert(!ett.IsConnected(3, 5));
+}
+
+// Runs batch links, cuts, and a save and load on a forest with 64-bit vertex
+// IDs: links a path in two batches, saves and loads it, and cuts every other
+// edge of both copies.
+void CheckEulerTourTree64() {
+  using Edge = EulerTourTree64::Edge;
+  EulerTourTree64 ett{num_vertices};
+  std::vector<Edge> path;
+  for (int64_t v = 0; v < num_vertices - 1; v++) {
+    path.emplace_back(v, v + 1);
+  }
+  const int64_t half{(num_vertices - 1) / 2};
+  ett.BatchLink(path.data(), half);
+  ett.BatchLink(path.data() + half, num_vertices - 1 - half);
+  for (int64_t v = 1; v < num_vertices; v++) {
+    assert(ett.IsConnected(0, v));
+  }
+
+  const char filename[]{"test_parallel_euler_tour_tree_forest64.bin"};
+  ett.Save(filename);
+  EulerTourTree64 loaded_ett{num_vertices};
+  loaded_ett.Load(filename);
+  std::remove(filename);
+  for (int64_t v = 1; v < num_vertices; v++) {
+    assert(loaded_ett.IsConnected(0, v));
+  }
+
+  std::vector<Edge> cuts;
+  for (int64_t v = 0; v < num_vertices - 1; v += 2) {
+    cuts.emplace_back(v + 1, v);
+  }
+  ett.BatchCut(cuts.data(), cuts.size());
+  loaded_ett.BatchCutOneRound(cuts.data(), cuts.size());
+  for (int64_t v = 0; v + 1 < num_vertices; v++) {
+    assert(ett.IsConnected(v, v + 1) == (v % 2 == 1));
+    assert(loaded_ett.IsConnected(v, v + 1) == (v % 2 == 1));
+  }
+}
+
+// Writes a file in the format of `EulerTourTree::Save` for an `n`-vertex forest
+// with a single tour holding `entries`, loads it into a forest in a child
+// process, and returns whether the load succeeded. Before loading, the forest
+// links and cuts a path through its vertices `num_churn_rounds` times. This
+// must run before
+// anything starts ParlayLib's workers, since the child only gets the thread
+// that forked it.
+bool LoadsForestFile(uint64_t n, const std::vector<int32_t>& entries,
+    int num_churn_rounds = 0) {
+  const char filename[]{"test_parallel_euler_tour_tree_handmade.bin"};
+  {
+    std::ofstream file{filename, std::ios::binary};
+    const uint64_t header[5]{n, 1, entries.size(), 0, entries.size()};
+    file.write(parallel_euler_tour_tree::kForestFileMagic,
+        sizeof(parallel_euler_tour_tree::kForestFileMagic));
+    file.write(reinterpret_cast<const char*>(header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(entries.data()),
+        sizeof(int32_t) * entries.size());
+  }
+  const pid_t pid{fork()};
+  if (pid == 0) {
+    EulerTourTree ett{static_cast<int>(n)};
+    for (int i = 0; i < num_churn_rounds; i++) {
+      for (int v = 1; v < static_cast<int>(n); v++) {
+        ett.Link(v - 1, v);
+      }
+      for (int v = 1; v < static_cast<int>(n); v++) {
+        ett.Cut(v - 1, v);
+      }
+    }
+    ett.Load(filename);
+    exit(0);
+  }
+  int status;
+  waitpid(pid, &status, 0);
+  std::remove(filename);
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+// Checks that loading rejects files whose tours list a vertex or an edge twice
+// or an edge without its twin, and accepts a correct file.
+void CheckLoadRejectsCorruptFiles() {
+  // (0, 0), (0, 1), (1, 1), (1, 0)
+  assert(LoadsForestFile(2, {0, 1, 1, 0}));
+  // (0, 0), (0, 1), (1, 1), (1, 0), (0, 0)
+  assert(!LoadsForestFile(2, {0, 1, 1, 0, 0}));
+  // (2, 0), (0, 0), (0, 1), (1, 1), (1, 2), (2, 2)
+  assert(!LoadsForestFile(3, {0, 0, 1, 1, 2, 2}));
+  // (0, 0), (0, 1), (1, 1), (1, 0), (0, 1), (1, 0)
+  assert(!LoadsForestFile(2, {0, 1, 1, 0, 1, 0}));
+  // Same as above after enough links and cuts to have deleted more edges than
+  // the edge table has slots.
+  assert(LoadsForestFile(3, {0, 1, 1, 0}, 200));
+  assert(!LoadsForestFile(3, {0, 0, 1, 1, 2, 2}, 200));
+}
+
+// Checks that listing the vertices of each vertex's tree, one at a time and in
+// a batch with every vertex queried twice, agrees with the reference.
+void CheckComponentVertices(
+    const SimpleForestConnectivity& reference_solution,
+    const EulerTourTree& ett) {
+  std::vector<int> queries;
+  for (int v = 0; v < num_vertices; v++) {
+    queries.push_back(v);
+    queries.push_back(num_vertices - 1 - v);
+  }
+  parlay::sequence<parlay::sequence<int>> components;
+  ett.BatchGetComponentVertices(queries.data(), queries.size(), &components);
+  assert(components.size() == queries.size());
+  for (size_t i = 0; i < queries.size(); i++) {
+    const int v{queries[i]};
+    parlay::sequence<int> component;
+    ett.GetComponentVertices(v, &component);
+    assert(std::equal(component.begin(), component.end(),
+        components[i].begin(), components[i].end()));
+    std::vector<bool> in_component(num_vertices, false);
+    for (int u : component) {
+      assert(!in_component[u]);
+      in_component[u] = true;
+    }
+    for (int u = 0; u < num_vertices; u++) {
+      assert(in_component[u] == reference_solution.IsConnected(u, v));
+    }
+  }
+}
+
+// Saves `ett`, loads the file into a new forest, and checks that the new forest
+// has the same connectivity and that all of its edges can be cut.
+void CheckSaveLoad(
+    const SimpleForestConnectivity& reference_solution,
+    EulerTourTree* ett,
+    const std::unordered_set<std::pair<int, int>, HashIntPairStruct>& edges) {
+  const char filename[]{"test_parallel_euler_tour_tree_forest.bin"};
+  ett->Save(filename);
+  EulerTourTree loaded_ett{num_vertices};
+  loaded_ett.Load(filename);
+  std::remove(filename);
+  CheckAllPairsConnectivity(reference_solution, loaded_ett);
+
+  std::vector<std::pair<int, int>> cuts(edges.begin(), edges.end());
+  loaded_ett.BatchCut(cuts.data(), cuts.size());
+  for (int v = 1; v < num_vertices; v++) {
+    assert(!loaded_ett.IsConnected(0, v));
+  }
+}
+
+// Returns the sum of `values` over the vertices that `v` reaches without going
+// through `parent` in the forest with adjacency lists `adjacency`, or over the
+// whole tree of `v` if `parent` equals `v`.
+int64_t ReferenceSubtreeSum(
+    const std::vector<std::unordered_set<int>>& adjacency,
+    const std::vector<int64_t>& values, int v, int parent) {
+  int64_t sum{0};
+  std::vector<std::pair<int, int>> stack{{v, parent}};
+  while (!stack.empty()) {
+    int x, from;
+    std::tie(x, from) = stack.back();
+    stack.pop_back();
+    sum += values[x];
+    for (int y : adjacency[x]) {
+      if (y != from) {
+        stack.emplace_back(y, x);
+      }
+    }
+  }
+  return sum;
+}
+
+// Checks `SubtreeAggregate` and `BatchSubtreeAggregate` in both directions
+// along every edge and on every whole tree of `ett` against the reference.
+void CheckSubtreeAggregateQueries(
+    const std::vector<std::unordered_set<int>>& adjacency,
+    const std::vector<int64_t>& values, const EulerTourTree& ett) {
+  std::vector<std::pair<int, int>> queries;
+  for (int v = 0; v < num_vertices; v++) {
+    queries.emplace_back(v, v);
+    for (int u : adjacency[v]) {
+      queries.emplace_back(v, u);
+    }
+  }
+  int64_t* aggregates{ett.BatchSubtreeAggregate(queries.data(), queries.size())};
+  for (size_t i = 0; i < queries.size(); i++) {
+    int v, parent;
+    std::tie(v, parent) = queries[i];
+    const int64_t expected{ReferenceSubtreeSum(adjacency, values, v, parent)};
+    assert(aggregates[i] == expected);
+    assert(ett.SubtreeAggregate(v, parent) == expected);
+  }
+  delete[] aggregates;
+}
+
+// Builds a random forest with subtree aggregates on, sets vertex values, and
+// checks subtree aggregates after batch links and cuts of both kinds, single
+// links and cuts, turning aggregates off and on again, and loading the forest.
+void CheckSubtreeAggregates() {
+  std::mt19937 rng{};
+  rng.seed(1);
+  EulerTourTree ett{num_vertices};
+  ett.SetSubtreeAggregatesEnabled(true);
+  std::vector<std::unordered_set<int>> adjacency(num_vertices);
+  std::vector<int64_t> values(num_vertices, 1);
+
+  // Attach each vertex to a random earlier one, except that every 50th vertex
+  // starts a new tree.
+  std::vector<std::pair<int, int>> links;
+  for (int v = 1; v < num_vertices; v++) {
+    if (v % 50 != 0) {
+      const int u = rng() % v;
+      links.emplace_back(v, u);
+      adjacency[u].insert(v);
+      adjacency[v].insert(u);
+    }
+  }
+  ett.BatchLink(links.data(), links.size());
+  CheckSubtreeAggregateQueries(adjacency, values, ett);
+
+  std::vector<int> changed_vertices;
+  std::vector<int64_t> new_values;
+  for (int v = 0; v < num_vertices; v += 3) {
+    changed_vertices.push_back(v);
+    new_values.push_back(static_cast<int64_t>(rng() % 100) - 50);
+    values[v] = new_values.back();
+  }
+  ett.BatchSetVertexValues(
+      changed_vertices.data(), new_values.data(), changed_vertices.size());
+  CheckSubtreeAggregateQueries(adjacency, values, ett);
+
+  // Cut a third of the edges in each of two batches, then link them back.
+  std::vector<std::pair<int, int>> cuts[2];
+  for (size_t i = 0; i < links.size(); i++) {
+    if (i % 3 < 2) {
+      cuts[i % 3].push_back(links[i]);
+      adjacency[links[i].first].erase(links[i].second);
+      adjacency[links[i].second].erase(links[i].first);
+    }
+  }
+  ett.BatchCut(cuts[0].data(), cuts[0].size());
+  ett.BatchCutOneRound(cuts[1].data(), cuts[1].size());
+  CheckSubtreeAggregateQueries(adjacency, values, ett);
+  for (const std::vector<std::pair<int, int>>& batch : cuts) {
+    for (const std::pair<int, int>& edge : batch) {
+      adjacency[edge.first].insert(edge.second);
+      adjacency[edge.second].insert(edge.first);
+    }
+  }
+  ett.BatchLink(cuts[1].data(), cuts[1].size());
+  for (const std::pair<int, int>& edge : cuts[0]) {
+    ett.Link(edge.first, edge.second);
+  }
+  CheckSubtreeAggregateQueries(adjacency, values, ett);
+  for (size_t i = 0; i < links.size(); i += 7) {
+    int u, v;
+    std::tie(u, v) = links[i];
+    ett.Cut(u, v);
+    adjacency[u].erase(v);
+    adjacency[v].erase(u);
+  }
+  CheckSubtreeAggregateQueries(adjacency, values, ett);
+
+  // Values go back to 1 when aggregates are turned on again.
+  ett.SetSubtreeAggregatesEnabled(false);
+  ett.SetSubtreeAggregatesEnabled(true);
+  values.assign(num_vertices, 1);
+  CheckSubtreeAggregateQueries(adjacency, values, ett);
+
+  const char filename[]{"test_parallel_euler_tour_tree_aggregates.bin"};
+  ett.Save(filename);
+  EulerTourTree loaded_ett{num_vertices};
+  loaded_ett.SetSubtreeAggregatesEnabled(true);
+  loaded_ett.Load(filename);
+  std::remove(filename);
+  CheckSubtreeAggregateQueries(adjacency, values, loaded_ett);
+}
+
+// Inserts batches of random edges, including self-loops, repeats in either
+// orientation, and edges within trees, with `BatchInsertEdgesFiltered`, and
+// checks that the accepted edges keep the forest acyclic and leave the endpoints
+// of every rejected edge connected.
+void CheckBatchInsertEdgesFiltered() {
+  std::mt19937 rng{};
+  rng.seed(2);
+  std::uniform_int_distribution<int> vert_dist{0, num_vertices - 1};
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree ett{num_vertices};
+  for (int round = 0; round < 3; round++) {
+    std::vector<std::pair<int, int>> edges;
+    for (int i = 0; i < num_vertices / 2; i++) {
+      const int u{vert_dist(rng)}, v{vert_dist(rng)};
+      edges.emplace_back(u, v);
+      if (i % 10 == 0) {
+        edges.emplace_back(v, u);
+        edges.emplace_back(u, u);
+      }
+    }
+    bool* accepted{new bool[edges.size()]};
+    ett.BatchInsertEdgesFiltered(edges.data(), edges.size(), accepted);
+    for (size_t i = 0; i < edges.size(); i++) {
+      if (accepted[i]) {
+        assert(!reference_solution.IsConnected(edges[i].first, edges[i].second));
+        reference_solution.Link(edges[i].first, edges[i].second);
+      }
+    }
+    delete[] accepted;
+    for (const std::pair<int, int>& edge : edges) {
+      assert(reference_solution.IsConnected(edge.first, edge.second));
+    }
+    CheckAllPairsConnectivity(reference_solution, ett);
+  }
+}
+
+// Checks `FindMarked` from every vertex, with no limit and with a limit of 3,
+// against the marked vertices of the vertex's tree in the forest with adjacency
+// lists `adjacency`.
+void CheckMarkedQueries(
+    const std::vector<std::unordered_set<int>>& adjacency,
+    const std::vector<bool>& marked,
+    const EulerTourTree& ett) {
+  for (int v = 0; v < num_vertices; v++) {
+    std::unordered_set<int> expected;
+    std::vector<int> stack{v};
+    std::vector<bool> visited(num_vertices, false);
+    visited[v] = true;
+    while (!stack.empty()) {
+      const int u{stack.back()};
+      stack.pop_back();
+      if (marked[u]) {
+        expected.insert(u);
+      }
+      for (int w : adjacency[u]) {
+        if (!visited[w]) {
+          visited[w] = true;
+          stack.push_back(w);
+        }
+      }
+    }
+    parlay::sequence<int> found;
+    ett.FindMarked(v, num_vertices, &found);
+    assert(found.size() == expected.size());
+    assert(std::unordered_set<int>(found.begin(), found.end()) == expected);
+    ett.FindMarked(v, 3, &found);
+    assert(found.size() == std::min<size_t>(3, expected.size()));
+    assert(std::unordered_set<int>(found.begin(), found.end()).size() ==
+        found.size());
+    for (int u : found) {
+      assert(expected.count(u) > 0);
+    }
+  }
+}
+
+// Marks and unmarks random vertices of a forest while linking and cutting it,
+// checking `FindMarked` after each batch.
+void CheckMarks() {
+  std::mt19937 rng{};
+  rng.seed(3);
+  EulerTourTree ett{num_vertices};
+  ett.SetSubtreeAggregatesEnabled(true);
+  std::vector<std::unordered_set<int>> adjacency(num_vertices);
+  std::vector<bool> marked(num_vertices, false);
+  CheckMarkedQueries(adjacency, marked, ett);
+
+  std::vector<int> vertices;
+  bool* marks{new bool[num_vertices]};
+  for (int v = 0; v < num_vertices; v++) {
+    if (rng() % 4 == 0) {
+      marks[vertices.size()] = marked[v] = true;
+      vertices.push_back(v);
+    }
+  }
+  ett.BatchSetMark(vertices.data(), marks, vertices.size());
+  CheckMarkedQueries(adjacency, marked, ett);
+
+  std::vector<std::pair<int, int>> links;
+  for (int v = 1; v < num_vertices; v++) {
+    if (v % 40 != 0) {
+      const int u = rng() % v;
+      links.emplace_back(v, u);
+      adjacency[u].insert(v);
+      adjacency[v].insert(u);
+    }
+  }
+  ett.BatchLink(links.data(), links.size());
+  CheckMarkedQueries(adjacency, marked, ett);
+
+  vertices.clear();
+  for (int v = 0; v < num_vertices; v += 5) {
+    marks[vertices.size()] = marked[v] = !marked[v];
+    vertices.push_back(v);
+  }
+  ett.BatchSetMark(vertices.data(), marks, vertices.size());
+  CheckMarkedQueries(adjacency, marked, ett);
+
+  std::vector<std::pair<int, int>> cuts;
+  for (size_t i = 0; i < links.size(); i += 4) {
+    cuts.push_back(links[i]);
+    adjacency[links[i].first].erase(links[i].second);
+    adjacency[links[i].second].erase(links[i].first);
+  }
+  ett.BatchCut(cuts.data(), cuts.size());
+  CheckMarkedQueries(adjacency, marked, ett);
+  delete[] marks;
+}
+
+// Cuts batches of a random forest's edges mixed with repeats in either
+// orientation, absent edges, and self-loops using `BatchCutFiltered`, and checks
+// that exactly the first cut of each present edge was applied.
+void CheckBatchCutFiltered() {
+  std::mt19937 rng{};
+  rng.seed(4);
+  std::uniform_int_distribution<int> vert_dist{0, num_vertices - 1};
+  SimpleForestConnectivity reference_solution{num_vertices};
+  EulerTourTree ett{num_vertices};
+  std::unordered_set<std::pair<int, int>, HashIntPairStruct> forest_edges;
+  std::vector<std::pair<int, int>> links;
+  for (int v = 1; v < num_vertices; v++) {
+    const int u = rng() % v;
+    links.emplace_back(u, v);
+    forest_edges.emplace(u, v);
+    reference_solution.Link(u, v);
+  }
+  ett.BatchLink(links.data(), links.size());
+
+  for (int round = 0; round < 3; round++) {
+    std::vector<std::pair<int, int>> cuts;
+    for (size_t i = round; i < links.size(); i += 3) {
+      int u, v;
+      std::tie(u, v) = links[i];
+      cuts.emplace_back(rng() % 2 == 0 ? std::make_pair(u, v)
+                                       : std::make_pair(v, u));
+      if (i % 2 == 0) {
+        cuts.emplace_back(v, u);
+        cuts.emplace_back(u, v);
+      }
+      if (i % 5 == 0) {
+        cuts.emplace_back(vert_dist(rng), vert_dist(rng));
+        cuts.emplace_back(u, u);
+      }
+    }
+    std::shuffle(cuts.begin(), cuts.end(), rng);
+    bool* applied{new bool[cuts.size()]};
+    ett.BatchCutFiltered(cuts.data(), cuts.size(), applied);
+    for (size_t i = 0; i < cuts.size(); i++) {
+      const std::pair<int, int> edge{
+          std::minmax(cuts[i].first, cuts[i].second)};
+      const bool present{forest_edges.erase(edge) > 0};
+      assert(applied[i] == present);
+      if (present) {
+        reference_solution.Cut(edge.first, edge.second);
+      }
+    }
+    delete[] applied;
+    CheckAllPairsConnectivity(reference_solution, ett);
+  }
+}
+
+// Links and cuts random trees until the edge table has seen many more deletions
+// than it has slots, then checks that `BatchCutFiltered` still skips edges that
+// are not in the forest. Deleted edges leave tombstones in the table, so this
+// checks that lookups of absent edges terminate.
+void CheckBatchCutFilteredAfterChurn() {
+  constexpr int num_churn_rounds{20};
+  std::mt19937 rng{};
+  rng.seed(6);
+  EulerTourTree ett{num_vertices};
+  std::vector<std::pair<int, int>> links;
+  const auto link_random_tree{[&]() {
+    links.clear();
+    for (int v = 1; v < num_vertices; v++) {
+      links.emplace_back(rng() % v, v);
+    }
+    ett.BatchLink(links.data(), links.size());
+  }};
+  for (int round = 0; round < num_churn_rounds; round++) {
+    link_random_tree();
+    ett.BatchCut(links.data(), links.size());
+  }
+
+  link_random_tree();
+  const std::unordered_set<std::pair<int, int>, HashIntPairStruct> tree_edges(
+      links.begin(), links.end());
+  std::vector<std::pair<int, int>> cuts;
+  for (int i = 0; i < num_vertices; i++) {
+    const int u = rng() % num_vertices, v = rng() % num_vertices;
+    cuts.emplace_back(u, v);
+  }
+  cuts.insert(cuts.end(), links.begin(), links.begin() + num_vertices / 2);
+  bool* applied{new bool[cuts.size()]};
+  ett.BatchCutFiltered(cuts.data(), cuts.size(), applied);
+  std::unordered_set<std::pair<int, int>, HashIntPairStruct> cut_edges;
+  for (size_t i = 0; i < cuts.size(); i++) {
+    const std::pair<int, int> edge{std::minmax(cuts[i].first, cuts[i].second)};
+    const bool present{tree_edges.count(edge) > 0 &&
+        cut_edges.insert(edge).second};
+    assert(applied[i] == present);
+  }
+  delete[] applied;
+  for (const std::pair<int, int>& edge : links) {
+    assert(ett.IsConnected(edge.first, edge.second) ==
+        (cut_edges.count(edge) == 0));
+  }
+}
+
+// Links random edges in several forests with overlapping lifetimes, destroys the
+// forests in a different order than they were created, and checks that each
+// forest is unaffected by the others coming and going.
+void CheckIndependentForests() {
+  constexpr int num_forests{4};
+  std::mt19937 rng{};
+  rng.seed(5);
+  std::vector<SimpleForestConnectivity> reference_solutions;
+  std::vector<EulerTourTree*> forests;
+  const auto link_random_forest{[&](int i) {
+    std::vector<std::pair<int, int>> links;
+    for (int v = 1; v < num_vertices; v++) {
+      if (rng() % 2 == 0) {
+        const int u = rng() % v;
+        links.emplace_back(u, v);
+        reference_solutions[i].Link(u, v);
+      }
+    }
+    forests[i]->BatchLink(links.data(), links.size());
+  }};
+  for (int i = 0; i < num_forests; i++) {
+    reference_solutions.emplace_back(num_vertices);
+    forests.push_back(new EulerTourTree{num_vertices});
+    if (i % 2 == 1) {
+      forests[i]->SetSubtreeAggregatesEnabled(true);
+    }
+    link_random_forest(i);
+  }
+
+  // Destroy every other forest, and replace it once the rest are checked.
+  for (int i = 0; i < num_forests; i += 2) {
+    delete forests[i];
+    forests[i] = nullptr;
+  }
+  for (int i = 1; i < num_forests; i += 2) {
+    CheckAllPairsConnectivity(reference_solutions[i], *forests[i]);
+  }
+  for (int i = 0; i < num_forests; i += 2) {
+    reference_solutions[i] = SimpleForestConnectivity{num_vertices};
+    forests[i] = new EulerTourTree{num_vertices};
+    link_random_forest(i);
+  }
+  for (int i = num_forests - 1; i >= 0; i--) {
+    CheckAllPairsConnectivity(reference_solutions[i], *forests[i]);
+    delete forests[i];
+  }
+}
+
+// Links and cuts random forests placed by each NUMA policy, adding vertices
+// partway through so that vertex elements are placed after construction too.
+void CheckNumaPolicies() {
+  for (numa_placement::Policy policy : {numa_placement::Policy::kFirstTouch,
+           numa_placement::Policy::kInterleaved,
+           numa_placement::Policy::kPartitioned}) {
+    std::mt19937 rng{};
+    rng.seed(6);
+    SimpleForestConnectivity reference_solution{num_vertices};
+    EulerTourTree ett{num_vertices / 2, policy};
+    int added[num_vertices - num_vertices / 2];
+    ett.AddVertices(num_vertices - num_vertices / 2, added);
+    std::vector<std::pair<int, int>> links;
+    for (int v = 1; v < num_vertices; v++) {
+      const int u = rng() % v;
+      links.emplace_back(u, v);
+      reference_solution.Link(u, v);
+    }
+    ett.BatchLink(links.data(), links.size());
+    CheckAllPairsConnectivity(reference_solution, ett);
+    std::vector<std::pair<int, int>> cuts;
+    for (size_t i = 0; i < links.size(); i += cut_ratio) {
+      cuts.push_back(links[i]);
+      reference_solution.Cut(links[i].first, links[i].second);
+    }
+    ett.BatchCut(cuts.data(), cuts.size());
+    CheckAllPairsConnectivity(reference_solution, ett);
+  }
+}
+
+// Optionally takes the filename of a forest to additionally test on.
+int main(int argc, char** argv) {
+  CheckLoadRejectsCorruptFiles();
+  if (argc > 1) {
+    CheckGraphFile(argv[1]);
+  }
+
   std::mt19937 rng{};
   rng.seed(0);
   std::uniform_int_distribution<std::mt19937::result_type>
@@ -38,12 +860,13 @@ int main() {
   EulerTourTree ett{num_vertices};
   std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
   std::pair<int, int>* ett_input{
-      pbbs::new_array_no_init<pair<int, int>>(num_vertices)};
+      new_array_no_init<std::pair<int, int>>(num_vertices)};
+  int input_len{0};
   for (int i = 0; i < num_rounds; i++) {
     // Generate `link_attempts_per_round` edges randomly, keeping each one that
     // doesn't add a cycle into the forest. Then call `BatchLink` on all of
     // them.
-    int input_len{0};
+    input_len = 0;
     for (int j = 0; j < link_attempts_per_round; j++) {
       const unsigned long u{vert_dist(rng)}, v{vert_dist(rng)};
       if (!reference_solution.IsConnected(u, v)) {
@@ -64,17 +887,58 @@ int main() {
       }
     }
     for (int j = 0; j < input_len; j++) {
-      pair<int, int> cut{ett_input[j]};
+      std::pair<int, int> cut{ett_input[j]};
       edges.erase(cut);
       if (coin(rng) == 1) {
-        ett_input[j] = make_pair(cut.second, cut.first);
+        ett_input[j] = std::make_pair(cut.second, cut.first);
       }
       reference_solution.Cut(cut.first, cut.second);
     }
-    ett.BatchCut(ett_input, input_len);
+    if (i % 2 == 0) {
+      ett.BatchCut(ett_input, input_len);
+    } else {
+      ett.BatchCutOneRound(ett_input, input_len);
+    }
     CheckAllPairsConnectivity(reference_solution, ett);
   }
-  pbbs::delete_array(ett_input, num_vertices);
+  CheckSaveLoad(reference_solution, &ett, edges);
+  CheckComponentVertices(reference_solution, ett);
+
+  // Cut everything, then link and cut a star. Cutting a star cuts a long run
+  // of adjacent tour edges around the center.
+  input_len = 0;
+  for (auto e : edges) {
+    ett_input[input_len++] = e;
+    reference_solution.Cut(e.first, e.second);
+  }
+  edges.clear();
+  ett.BatchCutOneRound(ett_input, input_len);
+  CheckAllPairsConnectivity(reference_solution, ett);
+  for (int v = 1; v < num_vertices; v++) {
+    ett_input[v - 1] = std::make_pair(0, v);
+    reference_solution.Link(0, v);
+  }
+  ett.BatchLink(ett_input, num_vertices - 1);
+  CheckAllPairsConnectivity(reference_solution, ett);
+  for (int v = 1; v < num_vertices; v++) {
+    reference_solution.Cut(0, v);
+  }
+  ett.BatchCutOneRound(ett_input, num_vertices - 1);
+  CheckAllPairsConnectivity(reference_solution, ett);
+  delete_array(ett_input, num_vertices);
+
+  CheckRepresentativeCache();
+  CheckSnapshotReader();
+  CheckSnapshotAfterMixedUpdates();
+  CheckAddVertices();
+  CheckEulerTourTree64();
+  CheckSubtreeAggregates();
+  CheckBatchInsertEdgesFiltered();
+  CheckMarks();
+  CheckBatchCutFiltered();
+  CheckBatchCutFilteredAfterChurn();
+  CheckIndependentForests();
+  CheckNumaPolicies();
 
   std::cout << "Test complete." << std::endl;
 }
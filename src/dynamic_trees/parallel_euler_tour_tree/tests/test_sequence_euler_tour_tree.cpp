@@ -0,0 +1,186 @@
+#include <dynamic_trees/parallel_euler_tour_tree/include/sequence_euler_tour_tree.hpp>
+#include <dynamic_trees/parallel_euler_tour_tree/tests/simple_forest_connectivity.hpp>
+
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include <utilities/include/hash_pair.hpp>
+
+namespace {
+
+constexpr int num_vertices{500};
+constexpr int link_attempts_per_round{400};
+constexpr int cut_ratio{3};
+constexpr int num_rounds{10};
+
+template <typename Forest>
+void CheckAllPairsConnectivity(
+    const SimpleForestConnectivity& reference_solution, const Forest& ett) {
+  std::vector<std::pair<int, int>> queries;
+  for (int u = 0; u < num_vertices; u++) {
+    for (int v = 0; v < num_vertices; v++) {
+      assert(reference_solution.IsConnected(u, v) == ett.IsConnected(u, v));
+      queries.emplace_back(u, v);
+    }
+  }
+  bool* connected{ett.BatchConnected(queries.data(), queries.size())};
+  for (size_t i = 0; i < queries.size(); i++) {
+    assert(connected[i] == reference_solution.IsConnected(
+        queries[i].first, queries[i].second));
+  }
+  delete[] connected;
+}
+
+// Runs rounds of random batch links and batch cuts, then single links and cuts,
+// then links and cuts a star, checking connectivity against a reference after
+// each step.
+template <typename Forest>
+void CheckForest() {
+  std::mt19937 rng{};
+  rng.seed(0);
+  std::uniform_int_distribution<int> vert_dist{0, num_vertices - 1};
+  std::uniform_int_distribution<int> coin{0, 1};
+
+  SimpleForestConnectivity reference_solution{num_vertices};
+  Forest ett{num_vertices};
+  std::unordered_set<std::pair<int, int>, HashIntPairStruct> edges{};
+  std::vector<std::pair<int, int>> ett_input;
+  for (int i = 0; i < num_rounds; i++) {
+    // Generate `link_attempts_per_round` edges randomly, keeping each one that
+    // doesn't add a cycle into the forest. Then call `BatchLink` on all of
+    // them.
+    ett_input.clear();
+    for (int j = 0; j < link_attempts_per_round; j++) {
+      const int u{vert_dist(rng)}, v{vert_dist(rng)};
+      if (!reference_solution.IsConnected(u, v)) {
+        reference_solution.Link(u, v);
+        edges.emplace(u, v);
+        ett_input.emplace_back(u, v);
+      }
+    }
+    ett.BatchLink(ett_input.data(), ett_input.size());
+    CheckAllPairsConnectivity(reference_solution, ett);
+
+    // Call `BatchCut` over each `cut_ratio`-th edge.
+    ett_input.clear();
+    int cnt{0};
+    for (auto e : edges) {
+      if (++cnt % cut_ratio == 0) {
+        ett_input.push_back(e);
+      }
+    }
+    for (std::pair<int, int>& cut : ett_input) {
+      edges.erase(cut);
+      reference_solution.Cut(cut.first, cut.second);
+      if (coin(rng) == 1) {
+        cut = std::make_pair(cut.second, cut.first);
+      }
+    }
+    ett.BatchCut(ett_input.data(), ett_input.size());
+    CheckAllPairsConnectivity(reference_solution, ett);
+  }
+
+  // A few single links and cuts.
+  for (int j = 0; j < 20; j++) {
+    const int u{vert_dist(rng)}, v{vert_dist(rng)};
+    if (!reference_solution.IsConnected(u, v)) {
+      reference_solution.Link(u, v);
+      edges.emplace(u, v);
+      ett.Link(u, v);
+    }
+  }
+  CheckAllPairsConnectivity(reference_solution, ett);
+  for (int j = 0; j < 20 && !edges.empty(); j++) {
+    const std::pair<int, int> e{*edges.begin()};
+    edges.erase(edges.begin());
+    reference_solution.Cut(e.first, e.second);
+    ett.Cut(e.second, e.first);
+  }
+  CheckAllPairsConnectivity(reference_solution, ett);
+
+  // Cut everything, then link and cut a star. Cutting a star cuts a long run
+  // of adjacent tour edges around the center.
+  ett_input.assign(edges.begin(), edges.end());
+  for (const std::pair<int, int>& e : ett_input) {
+    reference_solution.Cut(e.first, e.second);
+  }
+  edges.clear();
+  ett.BatchCut(ett_input.data(), ett_input.size());
+  CheckAllPairsConnectivity(reference_solution, ett);
+  ett_input.clear();
+  for (int v = 1; v < num_vertices; v++) {
+    ett_input.emplace_back(0, v);
+    reference_solution.Link(0, v);
+  }
+  ett.BatchLink(ett_input.data(), ett_input.size());
+  CheckAllPairsConnectivity(reference_solution, ett);
+  for (int v = 1; v < num_vertices; v++) {
+    reference_solution.Cut(0, v);
+  }
+  ett.BatchCut(ett_input.data(), ett_input.size());
+  CheckAllPairsConnectivity(reference_solution, ett);
+}
+
+// Links random edges in several forests with overlapping lifetimes, destroys the
+// forests in a different order than they were created, and checks that each
+// forest is unaffected by the others coming and going.
+template <typename Forest>
+void CheckIndependentForests() {
+  constexpr int num_forests{4};
+  std::mt19937 rng{};
+  rng.seed(5);
+  std::vector<SimpleForestConnectivity> reference_solutions;
+  std::vector<Forest*> forests;
+  const auto link_random_forest{[&](int i) {
+    std::vector<std::pair<int, int>> links;
+    for (int v = 1; v < num_vertices; v++) {
+      if (rng() % 2 == 0) {
+        const int u = rng() % v;
+        links.emplace_back(u, v);
+        reference_solutions[i].Link(u, v);
+      }
+    }
+    forests[i]->BatchLink(links.data(), links.size());
+  }};
+  for (int i = 0; i < num_forests; i++) {
+    reference_solutions.emplace_back(num_vertices);
+    forests.push_back(new Forest{num_vertices});
+    link_random_forest(i);
+  }
+
+  // Destroy every other forest, and replace it once the rest are checked.
+  for (int i = 0; i < num_forests; i += 2) {
+    delete forests[i];
+    forests[i] = nullptr;
+  }
+  for (int i = 1; i < num_forests; i += 2) {
+    CheckAllPairsConnectivity(reference_solutions[i], *forests[i]);
+  }
+  for (int i = 0; i < num_forests; i += 2) {
+    reference_solutions[i] = SimpleForestConnectivity{num_vertices};
+    forests[i] = new Forest{num_vertices};
+    link_random_forest(i);
+  }
+  for (int i = num_forests - 1; i >= 0; i--) {
+    CheckAllPairsConnectivity(reference_solutions[i], *forests[i]);
+    delete forests[i];
+  }
+}
+
+}  // namespace
+
+int main() {
+  CheckForest<parallel_euler_tour_tree::SkipListEulerTourTree>();
+  CheckForest<parallel_euler_tour_tree::AugmentedSkipListEulerTourTree>();
+  CheckForest<parallel_euler_tour_tree::TreapEulerTourTree>();
+  CheckIndependentForests<parallel_euler_tour_tree::SkipListEulerTourTree>();
+  CheckIndependentForests<
+      parallel_euler_tour_tree::AugmentedSkipListEulerTourTree>();
+  CheckIndependentForests<parallel_euler_tour_tree::TreapEulerTourTree>();
+
+  std::cout << "Test complete." << std::endl;
+}
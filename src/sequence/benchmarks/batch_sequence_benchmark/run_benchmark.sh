@@ -50,12 +50,21 @@ do
 done
 cd ..
 
-cd parallel_treap
-make -s
-benchmark_bin=${bin_dir}/benchmark_batch_sequence_parallel_treap
-echo "** parallel_treap (72h) ************************" | tee -a ../$batch_times_output ../$batch_backward_times_output
+# The parallel treap is built by CMake (see the top-level README).
+benchmark_bin=$(git rev-parse --show-toplevel)/build/tests/benchmark_parallel_treap
+for t in ${threads[@]}
+do
+  PARLAY_NUM_THREADS=$t numactl -i all $benchmark_bin -n $num_elements -k $batch_size -iters $iters >> ${threads_times_output}
+done
+echo "** parallel_treap (1) ************************" | tee -a $batch_times_output $batch_backward_times_output
 for k in ${batch_sizes[@]}
 do
-  CILK_NWORKERS=144 numactl -i all $benchmark_bin -n $num_elements -k $k -iters $iters                      >> ../$batch_times_output
+  PARLAY_NUM_THREADS=1   $benchmark_bin -n $num_elements -k $k -iters $iters                      >> $batch_times_output
+  PARLAY_NUM_THREADS=1   $benchmark_bin -n $num_elements -k $k -iters $iters -batch-type backward >> $batch_backward_times_output
+done
+echo "** parallel_treap (72h) ************************" | tee -a $batch_times_output $batch_backward_times_output
+for k in ${batch_sizes[@]}
+do
+  PARLAY_NUM_THREADS=144 numactl -i all $benchmark_bin -n $num_elements -k $k -iters $iters                      >> $batch_times_output
+  PARLAY_NUM_THREADS=144 numactl -i all $benchmark_bin -n $num_elements -k $k -iters $iters -batch-type backward >> $batch_backward_times_output
 done
-cd ..
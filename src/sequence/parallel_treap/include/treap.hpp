@@ -1,42 +1,122 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <utility>
 
 namespace treap {
 
-class Node {
+// Monoids for augmenting the treap. A monoid has a `Value` type, an
+// associative `Combine` and its `Identity`.
+template <typename T>
+struct Sum {
+  using Value = T;
+  static Value Identity() { return 0; }
+  static Value Combine(Value a, Value b) { return a + b; }
+};
+
+template <typename T>
+struct Min {
+  using Value = T;
+  static Value Identity() { return std::numeric_limits<T>::max(); }
+  static Value Combine(Value a, Value b) { return b < a ? b : a; }
+};
+
+// Node of a batch-parallel treap representing a sequence.
+//
+// Every node holds a value, and each subtree keeps its size and the combination
+// of its values in sequence order under `Monoid`, which are maintained through
+// splits and joins at O(1) extra cost per touched node. These give rank/select
+// and aggregates over contiguous subsequences in O(log n) expected time.
+//
+// The implementation is instantiated in treap.cpp for `Sum<int64_t>` and
+// `Min<int64_t>`; other monoids need an instantiation there too.
+template <typename Monoid>
+class BasicNode {
  public:
+  using Value = typename Monoid::Value;
+
   // Running this concurrently may lead to poor randomness.
-  Node();
-  explicit Node(unsigned random_int);
+  BasicNode();
+  explicit BasicNode(unsigned random_int);
+  BasicNode(unsigned random_int, Value value);
 
-  Node* GetRoot() const;
+  BasicNode* GetRoot() const;
 
   // Splits right after this node
-  std::pair<Node*, Node*> Split();
+  std::pair<BasicNode*, BasicNode*> Split();
   // Join tree containing lesser to tree containing greater and return root of
   // resulting tree.
-  static Node* Join(Node* lesser, Node* greater);
+  static BasicNode* Join(BasicNode* lesser, BasicNode* greater);
+
+  static void BatchSplit(BasicNode** splits, int len);
+  static void BatchJoin(std::pair<BasicNode*, BasicNode*>* joins, int len);
 
-  static void BatchSplit(Node** splits, int len);
-  static void BatchJoin(std::pair<Node*, Node*>* joins, int len);
+  // Returns the length of the sequence that this node lives in.
+  size_t GetSize() const;
+  // Returns the position of this node in its sequence, counting from 0.
+  size_t GetRank() const;
+  // Returns the node at position `rank` of this node's sequence. `rank` must be
+  // less than `GetSize()`.
+  BasicNode* Select(size_t rank) const;
+
+  Value GetValue() const { return value_; }
+  // Returns the combination of the values of the whole sequence that this node
+  // lives in.
+  Value GetSum() const;
+  // Returns the combination of the values between `left` and `right`
+  // inclusive. `left` and `right` must live in the same sequence, and `left`
+  // must not come after `right`.
+  static Value GetSubsequenceSum(const BasicNode* left, const BasicNode* right);
+
+  // For each `i`=0,1,...,`len`-1, assigns value `values[i]` to node
+  // `nodes[i]`. The nodes must be distinct. The aggregates of the ancestors of
+  // the nodes are recomputed in parallel, each ancestor only once.
+  static void BatchUpdate(BasicNode** nodes, const Value* values, int len);
 
  private:
-  void AssignChild(int i, Node* v);
-  static Node* JoinRoots(Node* lesser, Node* greater);
+  void AssignChild(int i, BasicNode* v);
+  // Recomputes the size and aggregate of this node's subtree from its
+  // children's.
+  void Update();
+  // Recomputes the aggregates of the descendants of this node that have
+  // `update_mark_` set, then of this node, clearing the marks.
+  void UpdateMarked();
+  // Returns the combination of the values at positions [`lo`, `hi`) of the
+  // subtree of `node`, where positions count from the subtree's leftmost node.
+  static Value RangeSum(const BasicNode* node, size_t lo, size_t hi);
+  static size_t SizeOf(const BasicNode* v) {
+    return v == nullptr ? 0 : v->size_;
+  }
+  static Value SumOf(const BasicNode* v) {
+    return v == nullptr ? Monoid::Identity() : v->sum_;
+  }
+  static BasicNode* JoinRoots(BasicNode* lesser, BasicNode* greater);
   static void BatchJoinRecurse(
-      std::pair<Node*, Node*>* joins,
+      std::pair<BasicNode*, BasicNode*>* joins,
       int len,
       bool* ignored,
-      Node** left_roots);
+      BasicNode** left_roots);
 
-  Node* parent_;
-  Node* child_[2];
+  BasicNode* parent_;
+  BasicNode* child_[2];
   unsigned priority_;
 
   // For batch join
-  Node* right_joiner_;
+  BasicNode* right_joiner_;
   bool has_left_joiner_;
+
+  // For batch update
+  bool update_mark_;
+
+  // Augmented data for the subtree rooted at this node
+  size_t size_;
+  Value value_;
+  Value sum_;
 };
 
+using Node = BasicNode<Sum<int64_t>>;
+using MinNode = BasicNode<Min<int64_t>>;
+
 }  // namespace treap
@@ -1,9 +1,15 @@
 #include <sequence/parallel_treap/include/treap.hpp>
 
+#include <algorithm>
+#include <cstdint>
 #include <tuple>
 
-#include <utilities/include/blockRadixSort.h>
-#include <utilities/include/random.h>
+#include <parlay/parallel.h>
+#include <parlay/primitives.h>
+#include <parlay/random.h>
+#include <parlay/sequence.h>
+#include <parlay/slice.h>
+#include <psl/utils.h>
 
 namespace treap {
 
@@ -11,7 +17,7 @@ using std::pair;
 
 namespace {
 
-  pbbs::random default_randomness;
+  parlay::random default_randomness;
   const int kSplitSequentialThreshold = 256;
   const int kSplitOneTreeSequentialThreshold = 64;
   const int kJoinSequentialThreshold = 64;
@@ -21,50 +27,72 @@ namespace {
 
 }  // namespace
 
-Node::Node(unsigned random_int)
+template <typename Monoid>
+BasicNode<Monoid>::BasicNode(unsigned random_int, Value value)
   : parent_(nullptr)
   , child_{nullptr, nullptr}
   , priority_(random_int)
   , right_joiner_(nullptr)
-  , has_left_joiner_(false) {}
-
-Node::Node() : Node(default_randomness.rand()) {
+  , has_left_joiner_(false)
+  , update_mark_(false)
+  , size_(1)
+  , value_(value)
+  , sum_(value) {}
+
+template <typename Monoid>
+BasicNode<Monoid>::BasicNode(unsigned random_int)
+  : BasicNode(random_int, Monoid::Identity()) {}
+
+template <typename Monoid>
+BasicNode<Monoid>::BasicNode() : BasicNode(default_randomness.ith_rand(0)) {
   default_randomness = default_randomness.next();  // race
 }
 
-void Node::AssignChild(int i, Node* v) {
+template <typename Monoid>
+void BasicNode<Monoid>::AssignChild(int i, BasicNode* v) {
   if (v != nullptr) {
     v->parent_ = this;
   }
   child_[i] = v;
 }
 
-Node* Node::GetRoot() const {
-  const Node* current = this;
+template <typename Monoid>
+void BasicNode<Monoid>::Update() {
+  size_ = SizeOf(child_[0]) + 1 + SizeOf(child_[1]);
+  sum_ = Monoid::Combine(
+      Monoid::Combine(SumOf(child_[0]), value_), SumOf(child_[1]));
+}
+
+template <typename Monoid>
+BasicNode<Monoid>* BasicNode<Monoid>::GetRoot() const {
+  const BasicNode* current = this;
   while (current->parent_ != nullptr) {
     current = current->parent_;
   }
-  return const_cast<Node*>(current);
+  return const_cast<BasicNode*>(current);
 }
 
-pair<Node*, Node*> Node::Split() {
-  Node* lesser = nullptr;
-  Node* greater = child_[1];
+template <typename Monoid>
+pair<BasicNode<Monoid>*, BasicNode<Monoid>*> BasicNode<Monoid>::Split() {
+  BasicNode* lesser = nullptr;
+  BasicNode* greater = child_[1];
   if (child_[1] != nullptr) {
     child_[1]->parent_ = nullptr;
     AssignChild(1, nullptr);
   }
 
-  Node* current = this;
+  BasicNode* current = this;
   bool traversed_up_from_right = 1;
   bool next_direction;
   while (current != nullptr) {
-    Node* p = current->parent_;
+    BasicNode* p = current->parent_;
     if (p != nullptr) {
       next_direction = p->child_[1] == current;
       p->AssignChild(next_direction, nullptr);
       current->parent_ = nullptr;
     }
+    // `current` has lost a child to the previous step.
+    current->Update();
     if (traversed_up_from_right) {
       lesser = Join(current, lesser);
     } else {
@@ -77,7 +105,9 @@ pair<Node*, Node*> Node::Split() {
   return {lesser, greater};
 }
 
-Node* Node::JoinRoots(Node* lesser, Node* greater) {
+template <typename Monoid>
+BasicNode<Monoid>* BasicNode<Monoid>::JoinRoots(
+    BasicNode* lesser, BasicNode* greater) {
   if (lesser == nullptr) {
     return greater;
   } else if (greater == nullptr) {
@@ -86,14 +116,18 @@ Node* Node::JoinRoots(Node* lesser, Node* greater) {
 
   if (lesser->priority_ > greater->priority_) {
     lesser->AssignChild(1, JoinRoots(lesser->child_[1], greater));
+    lesser->Update();
     return lesser;
   } else {
     greater->AssignChild(0, JoinRoots(lesser, greater->child_[0]));
+    greater->Update();
     return greater;
   }
 }
 
-Node* Node::Join(Node* lesser, Node* greater) {
+template <typename Monoid>
+BasicNode<Monoid>* BasicNode<Monoid>::Join(
+    BasicNode* lesser, BasicNode* greater) {
   return JoinRoots(
       lesser == nullptr ? nullptr : lesser->GetRoot(),
       greater == nullptr ? nullptr : greater->GetRoot());
@@ -102,7 +136,8 @@ Node* Node::Join(Node* lesser, Node* greater) {
 // Implementation: Divide and conquer --- Choose a random split and execute it.
 // Separate the remaining splits based on which tree they operate on and recurse
 // in parallel.
-void BatchSplitOneTree(Node** splits, int len, pbbs::random randomness) {
+template <typename Node>
+void BatchSplitOneTree(Node** splits, int len, parlay::random randomness) {
   if (len < kSplitOneTreeSequentialThreshold) {
     for (int i = 0; i < len; i++) {
       splits[i]->Split();
@@ -110,35 +145,43 @@ void BatchSplitOneTree(Node** splits, int len, pbbs::random randomness) {
     return;
   }
 
-  int pivot_index = randomness.rand() % len;
+  int pivot_index = randomness.ith_rand(0) % len;
   Node* pivot_node = splits[pivot_index];
   Node* left_parent, * right_parent;
   std::tie(left_parent, right_parent) = pivot_node->Split();
 
-  bool* flags = pbbs::new_array_no_init<bool>(len);
-  parallel_for (int i = 0; i < len; i++) {
+  bool* flags = new_array_no_init<bool>(len);
+  parlay::parallel_for(0, len, [&](size_t i) {
     flags[i] = splits[i]->GetRoot() == right_parent;
-  }
-  Node** splits_right = pbbs::new_array_no_init<Node*>(len);
-  const int len_right = utils::sequence::pack(splits, splits_right, flags, len);
-  cilk_spawn BatchSplitOneTree(splits_right, len_right, randomness.fork(1));
+  });
+  parlay::sequence<Node*> splits_right{parlay::pack(
+      parlay::make_slice(splits, splits + len),
+      parlay::make_slice(flags, flags + len))};
 
-  parallel_for (int i = 0; i < len; i++) {
+  parlay::parallel_for(0, len, [&](size_t i) {
     flags[i] = !flags[i];
-  }
+  });
   flags[pivot_index] = 0;
-  Node** splits_left = pbbs::new_array_no_init<Node*>(len);
-  const int len_left = utils::sequence::pack(splits, splits_left, flags, len);
-  BatchSplitOneTree(splits_left, len_left, randomness.fork(2));
+  parlay::sequence<Node*> splits_left{parlay::pack(
+      parlay::make_slice(splits, splits + len),
+      parlay::make_slice(flags, flags + len))};
+  delete_array(flags, len);
 
-  pbbs::delete_array(splits_left, len_left);
-  cilk_sync;
-  pbbs::delete_array(splits_right, len_right);
+  parlay::par_do(
+      [&] {
+        BatchSplitOneTree(
+            splits_right.data(), splits_right.size(), randomness.fork(1));
+      },
+      [&] {
+        BatchSplitOneTree(
+            splits_left.data(), splits_left.size(), randomness.fork(2));
+      });
 }
 
 // O(k log n log k) expected work and O(log n log k) depth with high probability
 // for k splits over n elements.
-void Node::BatchSplit(Node** splits, int len) {
+template <typename Monoid>
+void BasicNode<Monoid>::BatchSplit(BasicNode** splits, int len) {
   if (len < kSplitSequentialThreshold) {
     for (int i = 0; i < len; i++) {
       splits[i]->Split();
@@ -150,21 +193,17 @@ void Node::BatchSplit(Node** splits, int len) {
   // tree. Call BatchSplitOneTree on each set.
 
   // Sort splits to find splits that all operate on same tree.
-  pair<uintptr_t, Node*>* splits_by_tree =
-    pbbs::new_array_no_init<pair<uintptr_t, Node*>>(len);
-  parallel_for (int i = 0; i < len; i++) {
-    splits_by_tree[i] = make_pair(
+  pair<uintptr_t, BasicNode*>* splits_by_tree =
+    new_array_no_init<pair<uintptr_t, BasicNode*>>(len);
+  parlay::parallel_for(0, len, [&](size_t i) {
+    splits_by_tree[i] = std::make_pair(
         reinterpret_cast<uintptr_t>(splits[i]->GetRoot()), splits[i]);
-  }
-  intSort::iSort(splits_by_tree, len,
-    utils::sequence::mapReduce<uintptr_t>(
-      splits_by_tree,
-      len,
-      maxF<uintptr_t>(),
-      firstF<uintptr_t, Node*>()) + 1,
-    firstF<uintptr_t, Node*>());
-
-  parallel_for (int i = 0; i < len; i++) {
+  });
+  parlay::integer_sort_inplace(
+      parlay::make_slice(splits_by_tree, splits_by_tree + len),
+      [](const pair<uintptr_t, BasicNode*>& split) { return split.first; });
+
+  parlay::parallel_for(0, len, [&](size_t i) {
     // In parallel, split on each tree
     if (i == 0 || splits_by_tree[i].first != splits_by_tree[i - 1].first) {
       // Left endpoint of a contiguous batch of splits on a particular tree.
@@ -188,27 +227,28 @@ void Node::BatchSplit(Node** splits, int len) {
           splits_by_tree[j].second->Split();
         }
       } else {
-        Node** splits_on_this_tree =
-           pbbs::new_array_no_init<Node*>(len_this_tree);
-        parallel_for (int j = i; j < right_endpoint; j++) {
+        BasicNode** splits_on_this_tree =
+           new_array_no_init<BasicNode*>(len_this_tree);
+        parlay::parallel_for(i, right_endpoint, [&](size_t j) {
           splits_on_this_tree[j - i] = splits_by_tree[j].second;
-        }
+        });
         BatchSplitOneTree(
             splits_on_this_tree, len_this_tree, default_randomness.fork(i));
-        pbbs::delete_array(splits_on_this_tree, len_this_tree);
+        delete_array(splits_on_this_tree, len_this_tree);
       }
     }
-  }
+  });
   default_randomness = default_randomness.next();
 
-  pbbs::delete_array(splits_by_tree, len);
+  delete_array(splits_by_tree, len);
 }
 
-void Node::BatchJoinRecurse(
-    pair<Node*, Node*>* joins,
+template <typename Monoid>
+void BasicNode<Monoid>::BatchJoinRecurse(
+    pair<BasicNode*, BasicNode*>* joins,
     int len,
     bool* ignored,
-    Node** left_roots) {
+    BasicNode** left_roots) {
   if (len < kJoinSequentialThreshold) {
     for (int i = 0; i < len; i++) {
       Join(joins[i].first, joins[i].second);
@@ -220,47 +260,47 @@ void Node::BatchJoinRecurse(
   // a linked list on the trees where each list is not too long. In parallel on
   // each list, walk sequentially from left-to-right and perform joins.
 
-  parallel_for (int i = 0; i < len; i++) {
+  parlay::parallel_for(0, len, [&](size_t i) {
     ignored[i] =
       default_randomness.ith_rand(i) % kBatchJoinRecursiveFactor == 0;
-  }
+  });
   default_randomness = default_randomness.next();
 
-  parallel_for (int i = 0; i < len; i++) {
+  parlay::parallel_for(0, len, [&](size_t i) {
     if (!ignored[i]) {
-      Node* left_root = joins[i].first->GetRoot();
-      Node* right_root = joins[i].second->GetRoot();
+      BasicNode* left_root = joins[i].first->GetRoot();
+      BasicNode* right_root = joins[i].second->GetRoot();
       left_root->right_joiner_ = right_root;
       right_root->has_left_joiner_ = true;
       left_roots[i] = left_root;
     }
-  }
+  });
 
-  parallel_for (int i = 0; i < len; i++) {
+  parlay::parallel_for(0, len, [&](size_t i) {
     if (!ignored[i] && !left_roots[i]->has_left_joiner_) {
-      Node* current = left_roots[i];
-      Node* next = current->right_joiner_;
+      BasicNode* current = left_roots[i];
+      BasicNode* next = current->right_joiner_;
       current->right_joiner_ = nullptr;
       while (next != nullptr) {
-        Node* next_next = next->right_joiner_;
+        BasicNode* next_next = next->right_joiner_;
         next->right_joiner_ = nullptr;
         next->has_left_joiner_ = false;
         current = JoinRoots(current, next);
         next = next_next;
       }
     }
-  }
+  });
 
-  pair<Node*, Node*>* next_joins =
-    pbbs::new_array_no_init<pair<Node*, Node*>>(len);
-  int next_joins_len = utils::sequence::pack(joins, next_joins, ignored, len);
-  BatchJoinRecurse(next_joins, next_joins_len, ignored, left_roots);
-  pbbs::delete_array(next_joins, len);
+  parlay::sequence<pair<BasicNode*, BasicNode*>> next_joins{parlay::pack(
+      parlay::make_slice(joins, joins + len),
+      parlay::make_slice(ignored, ignored + len))};
+  BatchJoinRecurse(next_joins.data(), next_joins.size(), ignored, left_roots);
 }
 
 // O(k log n) expected work and O(log n log k) depth with high probability for k
 // joins over n elements.
-void Node::BatchJoin(pair<Node*, Node*>* joins, int len) {
+template <typename Monoid>
+void BasicNode<Monoid>::BatchJoin(pair<BasicNode*, BasicNode*>* joins, int len) {
   if (len < kJoinSequentialThreshold) {
     for (int i = 0; i < len; i++) {
       Join(joins[i].first, joins[i].second);
@@ -268,11 +308,129 @@ void Node::BatchJoin(pair<Node*, Node*>* joins, int len) {
     return;
   }
 
-  bool* ignored = pbbs::new_array_no_init<bool>(len);
-  Node** left_roots = pbbs::new_array_no_init<Node*>(len);
+  bool* ignored = new_array_no_init<bool>(len);
+  BasicNode** left_roots = new_array_no_init<BasicNode*>(len);
   BatchJoinRecurse(joins, len, ignored, left_roots);
-  pbbs::delete_array(left_roots, len);
-  pbbs::delete_array(ignored, len);
+  delete_array(left_roots, len);
+  delete_array(ignored, len);
+}
+
+template <typename Monoid>
+size_t BasicNode<Monoid>::GetSize() const {
+  return GetRoot()->size_;
 }
 
+template <typename Monoid>
+size_t BasicNode<Monoid>::GetRank() const {
+  size_t rank = SizeOf(child_[0]);
+  const BasicNode* current = this;
+  while (current->parent_ != nullptr) {
+    const BasicNode* p = current->parent_;
+    if (p->child_[1] == current) {
+      rank += SizeOf(p->child_[0]) + 1;
+    }
+    current = p;
+  }
+  return rank;
+}
+
+template <typename Monoid>
+BasicNode<Monoid>* BasicNode<Monoid>::Select(size_t rank) const {
+  BasicNode* current = GetRoot();
+  while (true) {
+    const size_t left_size = SizeOf(current->child_[0]);
+    if (rank < left_size) {
+      current = current->child_[0];
+    } else if (rank == left_size) {
+      return current;
+    } else {
+      rank -= left_size + 1;
+      current = current->child_[1];
+    }
+  }
+}
+
+template <typename Monoid>
+typename BasicNode<Monoid>::Value BasicNode<Monoid>::GetSum() const {
+  return GetRoot()->sum_;
+}
+
+// Implementation: Descend from the root along the paths to the two ends of the
+// range, taking whole subtrees that lie inside it.
+template <typename Monoid>
+typename BasicNode<Monoid>::Value BasicNode<Monoid>::RangeSum(
+    const BasicNode* node, size_t lo, size_t hi) {
+  if (node == nullptr || lo >= hi) {
+    return Monoid::Identity();
+  }
+  if (lo == 0 && hi >= node->size_) {
+    return node->sum_;
+  }
+  const size_t left_size = SizeOf(node->child_[0]);
+  Value sum = RangeSum(node->child_[0], lo, std::min(hi, left_size));
+  if (lo <= left_size && left_size < hi) {
+    sum = Monoid::Combine(sum, node->value_);
+  }
+  if (hi > left_size + 1) {
+    sum = Monoid::Combine(sum, RangeSum(node->child_[1],
+          lo > left_size + 1 ? lo - left_size - 1 : 0, hi - left_size - 1));
+  }
+  return sum;
+}
+
+template <typename Monoid>
+typename BasicNode<Monoid>::Value BasicNode<Monoid>::GetSubsequenceSum(
+    const BasicNode* left, const BasicNode* right) {
+  return RangeSum(left->GetRoot(), left->GetRank(), right->GetRank() + 1);
+}
+
+template <typename Monoid>
+void BasicNode<Monoid>::UpdateMarked() {
+  BasicNode* left = child_[0];
+  BasicNode* right = child_[1];
+  const bool update_left = left != nullptr && left->update_mark_;
+  const bool update_right = right != nullptr && right->update_mark_;
+  if (update_left && update_right) {
+    parlay::par_do(
+        [&] { left->UpdateMarked(); }, [&] { right->UpdateMarked(); });
+  } else if (update_left) {
+    left->UpdateMarked();
+  } else if (update_right) {
+    right->UpdateMarked();
+  }
+  Update();
+  update_mark_ = false;
+}
+
+// Implementation: Each node marks its ancestors until it reaches one that
+// another node already marked, so that the marked nodes form subtrees hanging
+// from the roots. The climb that marks a root then recomputes its marked
+// subtree top-down.
+template <typename Monoid>
+void BasicNode<Monoid>::BatchUpdate(
+    BasicNode** nodes, const Value* values, int len) {
+  parlay::parallel_for(0, len, [&](size_t i) {
+    nodes[i]->value_ = values[i];
+  });
+  BasicNode** top_nodes = new_array_no_init<BasicNode*>(len);
+  parlay::parallel_for(0, len, [&](size_t i) {
+    BasicNode* current = nodes[i];
+    BasicNode* last_marked = nullptr;
+    while (current != nullptr && CAS(&current->update_mark_, false, true)) {
+      last_marked = current;
+      current = current->parent_;
+    }
+    top_nodes[i] = current == nullptr ? last_marked : nullptr;
+  });
+  parlay::parallel_for(0, len, [&](size_t i) {
+    if (top_nodes[i] != nullptr) {
+      top_nodes[i]->UpdateMarked();
+    }
+  });
+  delete_array(top_nodes, len);
+}
+
+template class BasicNode<Sum<int64_t>>;
+template class BasicNode<Min<int64_t>>;
+
 }  // namespace treap
@@ -1,12 +1,18 @@
 #include <sequence/parallel_treap/include/treap.hpp>
 
+#include <algorithm>
 #include <cassert>
+#include <cstdint>
+#include <random>
+#include <vector>
 
+#include <parlay/parallel.h>
+#include <parlay/random.h>
+#include <psl/utils.h>
 #include <utilities/include/debug.hpp>
-#include <utilities/include/random.h>
-#include <utilities/include/utils.h>
 
 using Node = treap::Node;
+using MinNode = treap::MinNode;
 
 const int num_nodes = 10000;
 Node* nodes;
@@ -27,12 +33,142 @@ void prime_sieve() {
   }
 }
 
+// Checks sizes, ranks, selection, and sum and min aggregates over random
+// ranges of `aug_nodes` and `min_nodes`, which should form the same sequences
+// with the same values as `values`. The sequences are delimited by the nodes
+// after which `split_after` is true.
+void check_augmentation(const std::vector<int64_t>& values,
+                        const std::vector<bool>& split_after,
+                        Node* aug_nodes,
+                        MinNode* min_nodes,
+                        std::mt19937* rng) {
+  const int n = values.size();
+  std::vector<int> starts(n);
+  for (int i = 0, start = 0; i < n; i++) {
+    starts[i] = start;
+    if (split_after[i]) {
+      start = i + 1;
+    }
+  }
+  for (int i = 0; i < n; i++) {
+    const int start = starts[i];
+    int end = i;
+    while (end + 1 < n && !split_after[end]) {
+      end++;
+    }
+    assert(aug_nodes[i].GetRank() == static_cast<size_t>(i - start));
+    assert(aug_nodes[i].GetSize() == static_cast<size_t>(end - start + 1));
+    assert(aug_nodes[start].Select(i - start) == &aug_nodes[i]);
+    assert(min_nodes[i].GetRank() == static_cast<size_t>(i - start));
+
+    const int left = start + (*rng)() % (i - start + 1);
+    int64_t sum = 0;
+    int64_t min = values[left];
+    for (int j = left; j <= i; j++) {
+      sum += values[j];
+      min = std::min(min, values[j]);
+    }
+    assert(Node::GetSubsequenceSum(&aug_nodes[left], &aug_nodes[i]) == sum);
+    assert(MinNode::GetSubsequenceSum(&min_nodes[left], &min_nodes[i]) == min);
+    if (i == end) {
+      int64_t total = 0;
+      for (int j = start; j <= end; j++) {
+        total += values[j];
+      }
+      assert(aug_nodes[i].GetSum() == total);
+    }
+  }
+}
+
+// Joins, splits and updates augmented treaps in batches, checking the
+// augmentation after each step.
+void test_augmentation() {
+  const int n = 5000;
+  std::mt19937 rng{0};
+  parlay::random r;
+  std::vector<int64_t> values(n);
+  for (int i = 0; i < n; i++) {
+    values[i] = static_cast<int64_t>(rng() % 1000) - 500;
+  }
+  Node* aug_nodes = new_array_no_init<Node>(n);
+  MinNode* min_nodes = new_array_no_init<MinNode>(n);
+  parlay::parallel_for(0, n, [&](size_t i) {
+    new (&aug_nodes[i]) Node(r.ith_rand(i), values[i]);
+    new (&min_nodes[i]) MinNode(r.ith_rand(i), values[i]);
+  });
+  std::vector<bool> split_after(n, true);
+  check_augmentation(values, split_after, aug_nodes, min_nodes, &rng);
+
+  std::vector<std::pair<Node*, Node*>> joins;
+  std::vector<std::pair<MinNode*, MinNode*>> min_joins;
+  for (int i = 0; i < n - 1; i++) {
+    joins.emplace_back(&aug_nodes[i], &aug_nodes[i + 1]);
+    min_joins.emplace_back(&min_nodes[i], &min_nodes[i + 1]);
+  }
+  std::shuffle(joins.begin(), joins.end(), rng);
+  std::shuffle(min_joins.begin(), min_joins.end(), rng);
+  Node::BatchJoin(joins.data(), joins.size());
+  MinNode::BatchJoin(min_joins.data(), min_joins.size());
+  split_after.assign(n, false);
+  split_after[n - 1] = true;
+  check_augmentation(values, split_after, aug_nodes, min_nodes, &rng);
+
+  std::vector<Node*> nodes_to_update;
+  std::vector<MinNode*> min_nodes_to_update;
+  std::vector<int64_t> new_values;
+  for (int i = 0; i < n; i += 3) {
+    values[i] = static_cast<int64_t>(rng() % 1000) - 500;
+    nodes_to_update.push_back(&aug_nodes[i]);
+    min_nodes_to_update.push_back(&min_nodes[i]);
+    new_values.push_back(values[i]);
+  }
+  Node::BatchUpdate(
+      nodes_to_update.data(), new_values.data(), new_values.size());
+  MinNode::BatchUpdate(
+      min_nodes_to_update.data(), new_values.data(), new_values.size());
+  check_augmentation(values, split_after, aug_nodes, min_nodes, &rng);
+
+  std::vector<Node*> splits;
+  std::vector<MinNode*> min_splits;
+  for (int i = 0; i < n - 1; i++) {
+    if (rng() % 8 == 0) {
+      split_after[i] = true;
+      splits.push_back(&aug_nodes[i]);
+      min_splits.push_back(&min_nodes[i]);
+    }
+  }
+  Node::BatchSplit(splits.data(), splits.size());
+  MinNode::BatchSplit(min_splits.data(), min_splits.size());
+  check_augmentation(values, split_after, aug_nodes, min_nodes, &rng);
+
+  // Sequential splits and joins maintain the augmentation too.
+  for (int i = 0; i < n - 1; i += 97) {
+    if (!split_after[i]) {
+      split_after[i] = true;
+      aug_nodes[i].Split();
+      min_nodes[i].Split();
+    }
+  }
+  check_augmentation(values, split_after, aug_nodes, min_nodes, &rng);
+  for (int i = 0; i < n - 1; i += 3) {
+    if (split_after[i]) {
+      split_after[i] = false;
+      Node::Join(&aug_nodes[i], &aug_nodes[i + 1]);
+      MinNode::Join(&min_nodes[i], &min_nodes[i + 1]);
+    }
+  }
+  check_augmentation(values, split_after, aug_nodes, min_nodes, &rng);
+
+  delete_array(min_nodes, n);
+  delete_array(aug_nodes, n);
+}
+
 int main() {
-  pbbs::random r;
-  nodes = pbbs::new_array_no_init<Node>(num_nodes);
-  parallel_for (int i = 0; i < num_nodes; i++) {
+  parlay::random r;
+  nodes = new_array_no_init<Node>(num_nodes);
+  parlay::parallel_for(0, num_nodes, [&](size_t i) {
     new (&nodes[i]) Node(r.ith_rand(i));
-  }
+  });
 
   prime_sieve();
 
@@ -100,19 +236,19 @@ int main() {
   }
 
   std::pair<Node*, Node*>* joins =
-    pbbs::new_array_no_init<std::pair<Node*, Node*>>(num_nodes);
-  Node** splits = pbbs::new_array_no_init<Node*>(num_nodes);
+    new_array_no_init<std::pair<Node*, Node*>>(num_nodes);
+  Node** splits = new_array_no_init<Node*>(num_nodes);
   std::cout << "*** TEST PARALLEL ***" << std::endl;
   for (int T = 0; T < 3; T++) {
-    parallel_for (int i = 0; i < num_nodes - 1; i++) {
+    parlay::parallel_for(0, num_nodes - 1, [&](size_t i) {
       joins[i] = std::make_pair(&nodes[i], &nodes[i + 1]);
-    }
+    });
     Node::BatchJoin(joins, num_nodes - 1);
 
     Node* root0 = nodes[0].GetRoot();
-    parallel_for (int i = 0; i < num_nodes; i++) {
+    parlay::parallel_for(0, num_nodes, [&](size_t i) {
       assert(root0 == nodes[i].GetRoot());
-    }
+    });
 
     int len = 0;
     for (int i = 0; i < num_nodes; i++) {
@@ -122,13 +258,13 @@ int main() {
     }
     Node::BatchSplit(splits, len);
 
-    parallel_for (int i = 0; i < num_nodes; i++) {
+    parlay::parallel_for(0, num_nodes, [&](size_t i) {
       const int start = start_index_of_list[i];
       assert(nodes[start].GetRoot() == nodes[i].GetRoot());
       if (start > 0) {
         assert(nodes[start - 1].GetRoot() != nodes[i].GetRoot());
       }
-    }
+    });
 
     len = 0;
     for (int i = 0; i < num_nodes; i++) {
@@ -139,27 +275,27 @@ int main() {
     Node::BatchJoin(joins, len);
 
     root0 = nodes[0].GetRoot();
-    parallel_for (int i = 0; i < num_nodes; i++) {
+    parlay::parallel_for(0, num_nodes, [&](size_t i) {
       assert(root0 == nodes[i].GetRoot());
-    }
+    });
 
-    parallel_for (int i = 0; i < num_nodes - 1; i++) {
+    parlay::parallel_for(0, num_nodes - 1, [&](size_t i) {
       splits[i] = &nodes[i];
-    }
+    });
     Node::BatchSplit(splits, num_nodes - 1);
 
-    parallel_for (int i = 0; i < num_nodes; i++) {
+    parlay::parallel_for(0, num_nodes, [&](size_t i) {
       Node* iroot = nodes[i].GetRoot();
       for (int j = i + 1; j < num_nodes; j++) {
         assert(iroot != nodes[j].GetRoot());
       }
-    }
+    });
   }
 
   std::cout << "*** TEST PARALLEL MORE ***" << std::endl;
-  parallel_for (int i = 0; i < num_nodes - 1; i++) {
+  parlay::parallel_for(0, num_nodes - 1, [&](size_t i) {
     joins[i] = std::make_pair(&nodes[i], &nodes[i + 1]);
-  }
+  });
   for (int T = 0; T < 3; T++) {
     splits[0] = &nodes[num_nodes / 5];
     splits[1] = &nodes[num_nodes / 5 * 2];
@@ -167,29 +303,32 @@ int main() {
     splits[3] = &nodes[num_nodes / 5 * 4];
     Node::BatchSplit(splits, 4);
 
-    parallel_for (int i = 0; i < num_nodes - 1; i++) {
+    parlay::parallel_for(0, num_nodes - 1, [&](size_t i) {
       splits[i] = &nodes[i];
-    }
+    });
     Node::BatchSplit(splits, num_nodes - 1);
 
-    parallel_for (int i = 0; i < num_nodes; i++) {
+    parlay::parallel_for(0, num_nodes, [&](size_t i) {
       Node* iroot = nodes[i].GetRoot();
       for (int j = i + 1; j < num_nodes; j++) {
         assert(iroot != nodes[j].GetRoot());
       }
-    }
+    });
 
     Node::BatchJoin(joins, num_nodes - 1);
 
     Node* root0 = nodes[0].GetRoot();
-    parallel_for (int i = 0; i < num_nodes; i++) {
+    parlay::parallel_for(0, num_nodes, [&](size_t i) {
       assert(root0 == nodes[i].GetRoot());
-    }
+    });
   }
 
-  pbbs::delete_array(splits, num_nodes);
-  pbbs::delete_array(joins, num_nodes);
-  pbbs::delete_array(nodes, num_nodes);
+  delete_array(splits, num_nodes);
+  delete_array(joins, num_nodes);
+  delete_array(nodes, num_nodes);
+
+  std::cout << "*** TEST AUGMENTATION ***" << std::endl;
+  test_augmentation();
 
   std::cout << "Test complete." << std::endl;
 
@@ -65,11 +65,11 @@ pair<AugmentedElement*, int> AugmentedElement::FindLeftParentAndSum(
   do {
     sum += current_node->vals[level];
     if (current_node->height > level + 1) {
-      return make_pair(current_node, sum);
+      return std::make_pair(current_node, sum);
     }
     current_node = current_node->neighbors[level].prev;
   } while (current_node != nullptr && current_node != start_node);
-  return make_pair(nullptr, sum);
+  return std::make_pair(nullptr, sum);
 }
 
 pair<AugmentedElement*, int> AugmentedElement::FindRightParentAndSum(
@@ -79,12 +79,12 @@ pair<AugmentedElement*, int> AugmentedElement::FindRightParentAndSum(
   AugmentedElement* start_node = current_node;
   do {
     if (current_node->height > level + 1) {
-      return make_pair(current_node, sum);
+      return std::make_pair(current_node, sum);
     }
     sum += current_node->vals[level];
     current_node = current_node->neighbors[level].next;
   } while (current_node != nullptr && current_node != start_node);
-  return make_pair(nullptr, sum);
+  return std::make_pair(nullptr, sum);
 }
 
 void AugmentedElement::BatchJoin(
@@ -0,0 +1,54 @@
+// Hash functions from utils.h, split out so that they may be used without
+// pulling in the Cilk Plus `parallel_for` macros.
+#pragma once
+
+#include <cstdint>
+
+inline unsigned int hashInt(unsigned int a) {
+   a = (a+0x7ed55d16) + (a<<12);
+   a = (a^0xc761c23c) ^ (a>>19);
+   a = (a+0x165667b1) + (a<<5);
+   a = (a+0xd3a2646c) ^ (a<<9);
+   a = (a+0xfd7046c5) + (a<<3);
+   a = (a^0xb55a4f09) ^ (a>>16);
+   return a;
+}
+
+inline unsigned long hashInt(unsigned long a) {
+   a = (a+0x7ed55d166bef7a1d) + (a<<12);
+   a = (a^0xc761c23c510fa2dd) ^ (a>>9);
+   a = (a+0x165667b183a9c0e1) + (a<<59);
+   a = (a+0xd3a2646cab3487e3) ^ (a<<49);
+   a = (a+0xfd7046c5ef9ab54c) + (a<<3);
+   a = (a^0xb55a4f090dd4a67b) ^ (a>>32);
+   return a;
+}
+
+namespace pbbs {
+
+  // a 32-bit hash function
+  inline uint32_t hash32(uint32_t a) {
+    a = (a+0x7ed55d16) + (a<<12);
+    a = (a^0xc761c23c) ^ (a>>19);
+    a = (a+0x165667b1) + (a<<5);
+    a = (a+0xd3a2646c) ^ (a<<9);
+    a = (a+0xfd7046c5) + (a<<3);
+    a = (a^0xb55a4f09) ^ (a>>16);
+    return a;
+  }
+
+  // from numerical recipes
+  inline uint64_t hash64(uint64_t u )
+  {
+    uint64_t v = u * 3935559000370003845 + 2691343689449507681;
+    v ^= v >> 21;
+    v ^= v << 37;
+    v ^= v >>  4;
+    v *= 4768777513237032717;
+    v ^= v << 20;
+    v ^= v >> 41;
+    v ^= v <<  5;
+    return v;
+  }
+
+}  // namespace pbbs
@@ -1,8 +1,9 @@
 #pragma once
 
+#include <cstdint>
 #include <utility>
 
-#include <utilities/include/utils.h>
+#include <utilities/include/hash.h>
 
 inline unsigned hashIntPair(const std::pair<unsigned, unsigned>& p) {
   unsigned h{hashInt(p.first)};
@@ -10,6 +11,13 @@ inline unsigned hashIntPair(const std::pair<unsigned, unsigned>& p) {
   return h;
 }
 
+inline unsigned long hashIntPair64(
+    const std::pair<unsigned long, unsigned long>& p) {
+  unsigned long h{hashInt(p.first)};
+  h ^= hashInt(p.second) + 0x9e3779b97f4a7c15 + (h << 6) + (h >> 2);
+  return h;
+}
+
 // For use in hash containers. For instance:
 //   std::unordered_map<std::pair<int, int>, std::string, HashIntPairStruct>
 //     int_to_string_map;
@@ -17,4 +25,7 @@ struct HashIntPairStruct {
   size_t operator () (const std::pair<int, int> &p) const {
     return hashIntPair(p);
   }
+  size_t operator () (const std::pair<int64_t, int64_t> &p) const {
+    return hashIntPair64(p);
+  }
 };
@@ -22,7 +22,10 @@
 
 #pragma once
 
-#include "utils.h"
+#include <cstddef>
+#include <cstdint>
+
+#include "hash.h"
 
 namespace pbbs {
 
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <algorithm>
 #include <cassert>
 #include <random>
 #include <string>
@@ -9,6 +10,7 @@
 #include "parse_command_line.h"
 #include <parlay/internal/get_time.h>
 #include <psl/debug.hpp>
+#include <psl/perf_counters.hpp>
 #include <psl/utils.h>
 
 using std::string;
@@ -71,8 +73,9 @@ void ConstructJoinsAndSplitsFromIndices(int *indices, Element *elements,
 
 // Pick `batch_size` many element locations according to `GetBatchIndices`.
 // For `num_iterations` iterations, construct a list and then batch split and
-// batch join on those locations. Report the median batch split and batch join
-// times.
+// batch join on those locations, and then query the aggregate over the range
+// between each location and the next one in the batch. Report the median batch
+// split, batch join and aggregate query times.
 template <typename Element>
 void RunBenchmark(Element *elements, const BenchmarkParameters &parameters) {
   const int num_elements{parameters.num_elements};
@@ -105,11 +108,26 @@ void RunBenchmark(Element *elements, const BenchmarkParameters &parameters) {
   ConstructJoinsAndSplitsFromIndices(batch_indices, elements, batch_size,
                                      batch_joins, batch_splits);
 
+  // Query ranges, with the left end first.
+  ElementPPair *batch_ranges{new_array_no_init<ElementPPair>(batch_size)};
+  parlay::parallel_for(0, batch_size, [&](size_t i) {
+    const int a{batch_indices[i]};
+    const int b{batch_indices[(i + 1) % batch_size]};
+    batch_ranges[i] =
+        make_pair(&elements[std::min(a, b)], &elements[std::max(a, b)]);
+  });
+  using Sum = decltype(Element::GetSubsequenceSum(elements, elements));
+  Sum *range_sums{new_array_no_init<Sum>(batch_size)};
+
   vector<double> split_times(num_iterations);
   vector<double> join_times(num_iterations);
+  vector<double> sum_times(num_iterations);
+  std::vector<perf_counters::PhaseCounts> phase_counts;
+  perf_counters::Initialize();
 
   for (int j = 0; j < num_iterations; j++) {
     Element::BatchJoin(construct_joins, num_elements - 1);
+    perf_counters::TakePhaseCounts();
 
     timer split_t;
     split_t.start();
@@ -121,17 +139,30 @@ void RunBenchmark(Element *elements, const BenchmarkParameters &parameters) {
     Element::BatchJoin(batch_joins, batch_size);
     join_times[j] = join_t.stop();
 
+    timer sum_t;
+    sum_t.start();
+    parlay::parallel_for(0, batch_size, [&](size_t i) {
+      range_sums[i] = Element::GetSubsequenceSum(batch_ranges[i].first,
+                                                 batch_ranges[i].second);
+    });
+    sum_times[j] = sum_t.stop();
+    perf_counters::AddPhaseCounts(&phase_counts,
+                                  perf_counters::TakePhaseCounts());
+
     Element::BatchSplit(destruct_splits, num_elements - 1);
   }
 
   std::cout << "join " << median(join_times) << " split " << median(split_times)
-            << '\n';
+            << " sum " << median(sum_times) << '\n';
+  perf_counters::ReportPhaseCounts(std::cout, phase_counts, num_iterations);
 
   delete_array(perm, num_elements - 1);
   delete_array(construct_joins, num_elements - 1);
   delete_array(destruct_splits, num_elements - 1);
   delete_array(batch_joins, batch_size);
   delete_array(batch_splits, batch_size);
+  delete_array(batch_ranges, batch_size);
+  delete_array(range_sums, batch_size);
 }
 
 } // namespace batch_sequence_benchmark
\ No newline at end of file
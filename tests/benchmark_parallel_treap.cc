@@ -0,0 +1,22 @@
+#include "benchmark_augmented_skip_list.hpp"
+#include <parlay/parallel.h>
+#include <parlay/random.h>
+#include <psl/utils.h>
+#include <sequence/parallel_treap/include/treap.hpp>
+
+int main(int argc, char **argv) {
+  namespace bsb = batch_sequence_benchmark;
+  using Element = treap::Node;
+  bsb::BenchmarkParameters parameters{bsb::GetBenchmarkParameters(argc, argv)};
+  Element *elements{new_array_no_init<Element>(parameters.num_elements)};
+  parlay::random r{};
+  parlay::parallel_for(0, parameters.num_elements, [&](size_t i) {
+    // Value 1, as in `parallel_skip_list::AugmentedElement`.
+    new (&elements[i]) Element{static_cast<unsigned>(r.ith_rand(i)), 1};
+  });
+
+  bsb::RunBenchmark(elements, parameters);
+
+  delete_array(elements, parameters.num_elements);
+  return 0;
+}
@@ -15,6 +15,13 @@ void skip_list(int argc, char **argv) {
   });
 
   sequence_benchmark::RunBenchmark(elements, parameters);
+  // Each level holds a pair of neighbor pointers.
+  sequence_benchmark::ReportLevelArrayFootprint(
+      elements, parameters.num_elements, 2 * sizeof(Element *));
+  if (operation_counters::kEnabled) {
+    operation_counters::ReportOperationCounts(std::cout,
+                                              Element::GetOperationCounts());
+  }
 
   delete_array(elements, parameters.num_elements);
   Element::Finish();
@@ -32,6 +39,13 @@ void augmented_skip_list(int argc, char **argv) {
   });
 
   bsb::RunBenchmark(elements, parameters);
+  // Each level holds a pair of neighbor pointers and a value.
+  sequence_benchmark::ReportLevelArrayFootprint(
+      elements, parameters.num_elements, 2 * sizeof(Element *) + sizeof(int));
+  if (operation_counters::kEnabled) {
+    operation_counters::ReportOperationCounts(std::cout,
+                                              Element::GetOperationCounts());
+  }
 
   delete_array(elements, parameters.num_elements);
   Element::Finish();
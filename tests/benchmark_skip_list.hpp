@@ -7,6 +7,8 @@
 
 #include "parse_command_line.h"
 #include <parlay/internal/get_time.h>
+#include <parlay/primitives.h>
+#include <psl/concurrent_array_allocator.hpp>
 #include <psl/debug.hpp>
 #include <psl/utils.h>
 
@@ -30,6 +32,32 @@ inline BenchmarkParameters GetBenchmarkParameters(int argc, char **argv) {
   return parameters;
 }
 
+// Reports the memory taken by the per-level arrays of the `num_elements`
+// elements in `elements`, where each level of an element takes
+// `bytes_per_level` bytes, and how much less that is than with power-of-2 size
+// classes in `concurrent_array_allocator`.
+template <typename Element>
+void ReportLevelArrayFootprint(const Element *elements, int num_elements,
+                               size_t bytes_per_level) {
+  namespace caa = concurrent_array_allocator;
+  const auto total_length{[&](auto allocated_length) {
+    return parlay::reduce(parlay::delayed_seq<size_t>(
+        num_elements, [&](size_t i) -> size_t {
+          return allocated_length(elements[i].Height());
+        }));
+  }};
+  const size_t bytes{
+      bytes_per_level *
+      total_length([](int height) { return caa::AllocatedLength(height); })};
+  const size_t power_of_two_bytes{
+      bytes_per_level *
+      total_length([](int height) { return caa::PowerOfTwoLength(height); })};
+  std::cout << "level arrays " << bytes << " bytes ("
+            << power_of_two_bytes << " with power-of-2 size classes, "
+            << 100.0 * (power_of_two_bytes - bytes) / power_of_two_bytes
+            << "% saved)\n";
+}
+
 // Pick `batch_size` many element locations at random. For `num_iterations`
 // iterations, construct a list and then split and join on those locations.
 // Report the median time to perform all these splits and joins.
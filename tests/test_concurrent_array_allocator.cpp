@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <vector>
+
+#include <psl/concurrent_array_allocator.hpp>
+
+using concurrent_array_allocator::Pool;
+
+// Checks that slots freed by one worker get reused by another, so a pool whose
+// slots are always allocated on one worker and freed on another does not grow.
+void CheckFreesOnOtherWorkerAreReused() {
+  constexpr size_t kNumSlots{10000};
+  constexpr int kNumRounds{50};
+  Pool pool{sizeof(int), alignof(int), {}, 2};
+  std::vector<void *> slots(kNumSlots);
+  size_t first_round_footprint{0};
+  for (int round = 0; round < kNumRounds; round++) {
+    for (void *&slot : slots) {
+      slot = pool.Allocate(0);
+    }
+    for (void *slot : slots) {
+      pool.Free(slot, 1);
+    }
+    if (round == 0) {
+      first_round_footprint = pool.FootprintBytes();
+    }
+  }
+  assert(first_round_footprint >= kNumSlots * sizeof(int));
+  assert(pool.FootprintBytes() <= 2 * first_round_footprint);
+}
+
+// Checks that slots handed out at the same time are distinct and owned by the
+// pool, also when some of them come back through the shared free slots.
+void CheckSlotsAreDistinct() {
+  constexpr size_t kNumSlots{5000};
+  Pool pool{sizeof(long), alignof(long), {}, 2};
+  std::vector<void *> slots(kNumSlots);
+  for (void *&slot : slots) {
+    slot = pool.Allocate(0);
+  }
+  for (void *slot : slots) {
+    pool.Free(slot, 1);
+  }
+  std::vector<char *> reused(kNumSlots);
+  for (size_t i = 0; i < kNumSlots; i++) {
+    reused[i] = static_cast<char *>(pool.Allocate(i % 2));
+    assert(Pool::Owner(reused[i]) == &pool);
+  }
+  std::sort(reused.begin(), reused.end());
+  for (size_t i = 1; i < kNumSlots; i++) {
+    assert(reused[i] - reused[i - 1] >= static_cast<long>(sizeof(long)));
+  }
+}
+
+int main() {
+  CheckFreesOnOtherWorkerAreReused();
+  CheckSlotsAreDistinct();
+  return 0;
+}
@@ -29,6 +29,20 @@ void PrimeSieve() {
   }
 }
 
+// Checks that `Flatten` lists the list containing `element` from its head (or
+// from anywhere on a cycle) and matches a sequential walk.
+void CheckFlatten(Element *element) {
+  const parlay::sequence<Element *> flattened{Element::Flatten(element)};
+  Element *current{flattened[0]};
+  assert(current->GetPreviousElement() == nullptr ||
+         current->GetPreviousElement() == flattened[flattened.size() - 1]);
+  for (size_t k = 0; k < flattened.size(); k++) {
+    assert(flattened[k] == current);
+    current = current->GetNextElement();
+  }
+  assert(current == nullptr || current == flattened[0]);
+}
+
 int main() {
   Element::Initialize();
   parlay::random r;
@@ -65,6 +79,9 @@ int main() {
   parlay::parallel_for(0, kNumElements, [&](size_t i) {
     assert(representative_0 == elements[i].FindRepresentative());
   });
+  assert(Element::Flatten(&elements[kNumElements / 2]).size() ==
+         kNumElements);
+  CheckFlatten(&elements[kNumElements / 2]);
 
   // Join into one big cycle
   Element::Join(&elements[kNumElements - 1], &elements[0]);
@@ -73,6 +90,8 @@ int main() {
   parlay::parallel_for(0, kNumElements, [&](size_t i) {
     assert(representative_0 == elements[i].FindRepresentative());
   });
+  assert(Element::Flatten(&elements[0]).size() == kNumElements);
+  CheckFlatten(&elements[0]);
 
   // Split into lists
   parlay::parallel_for(0, kNumElements, [&](size_t i) {
@@ -90,6 +109,11 @@ int main() {
              elements[i].FindRepresentative());
     }
   });
+  parlay::parallel_for(0, kNumElements, [&](size_t i) {
+    if (split_points[i]) {
+      CheckFlatten(&elements[i]);
+    }
+  });
 
   // Join individual lists into individual cycles
   parlay::parallel_for(0, kNumElements, [&](size_t i) {
@@ -107,6 +131,11 @@ int main() {
              elements[i].FindRepresentative());
     }
   });
+  parlay::parallel_for(0, kNumElements, [&](size_t i) {
+    if (split_points[i]) {
+      CheckFlatten(&elements[i]);
+    }
+  });
 
   // Break cycles back into lists
   parlay::parallel_for(0, kNumElements, [&](size_t i) {